@@ -1,8 +1,10 @@
 #include <vector>
 #include <string>
-#include <unordered_map>
+#include <type_traits>
 #include <queue>
 #include <iostream>
+#include <thread>
+#include <algorithm>
 
 using namespace std;
 
@@ -15,86 +17,228 @@ typedef vector<size_t> VI;
 typedef vector<string> VS;
 
 struct node {
-    unordered_map<char, node*> g;
+    node *child = NULL, *sibling = NULL;    // first child, and the next child of the same
+                                            // parent; siblings are sorted by c
+    char c = 0;     // label of the edge into this node
     node* f;    // pointer to node with largest strict suffix of current node in automaton
     node* output = NULL;    // pointer to dictionary suffix, the next node with isWord=true by
                             // following f pointers
     bool isWord = false;
+    size_t nwords = 0;
+    size_t *wbeg = NULL, *wend = NULL;  // indices of the dictionary words ending here (several
+                                        // if repeated), stored in the arena
     size_t num;
 
     node(size_t num) : num(num) {}
     node() {}
 };
 
-void enter(string S, node *root, size_t &n) {
-    node *state = root;
-    size_t j = 0;
-    while (state->g.count(S[j]) != 0) {
-        state = state->g[S[j]];
-        ++j;
-    }
-    for (; j < S.size(); ++j) {
-        state->g[S[j]] = new node(n++);
-        state = state->g[S[j]];
+// Owns the nodes of an automaton, with nodes[i].num == i, and the word
+// indices they point to. Nodes hold only pointers into the arena, so they are
+// trivially destructible: rebuilding drops the old automaton in O(1), and
+// allocates nothing once the arena has grown to the dictionary's size.
+struct ac_arena {
+    vector<node> nodes;
+    VI words, term;     // word indices grouped by node; word id ends at nodes[term[id]]
+};
+
+// the child of state along c, or NULL
+node* child(node *state, char c) {
+    node *t = state->child;
+    while (t != NULL && t->c < c) t = t->sibling;
+    return t != NULL && t->c == c ? t : NULL;
+}
+
+// The arena must have enough capacity reserved up front so that node pointers
+// stay valid. id is the index of S in the dictionary.
+void enter(const string &S, size_t id, ac_arena &A) {
+    node *state = &A.nodes[0];
+    for (size_t j = 0; j < S.size(); ++j) {
+        node **p = &state->child;
+        while (*p != NULL && (*p)->c < S[j]) p = &(*p)->sibling;
+        if (*p == NULL || (*p)->c != S[j]) {
+            A.nodes.emplace_back(A.nodes.size());
+            node *t = &A.nodes.back();
+            t->c = S[j]; t->sibling = *p; *p = t;
+        }
+        state = *p;
     }
     state->isWord = true;
+    ++state->nwords;
+    A.term[id] = state->num;
 }
 
 void construct_f(node *root) {
     queue<node*> q;
-    for (auto it = root->g.begin(); it != root->g.end(); ++it) {
-        q.push(it->second);
-        it->second->f = root;
+    for (node *t = root->child; t != NULL; t = t->sibling) {
+        q.push(t);
+        t->f = root;
     }
     while (!q.empty()) {
         node *r = q.front(); q.pop();
-        for (auto it = r->g.begin(); it != r->g.end(); ++it) {
-            q.push(it->second);
+        for (node *t = r->child; t != NULL; t = t->sibling) {
+            q.push(t);
             node *state = r->f;
-            while (state->g.count(it->first) == 0 && state->num != 0)
+            while (child(state, t->c) == NULL && state->num != 0)
                 state = state->f;
-            if (state->g.count(it->first) != 0)
-                it->second->f = state->g[it->first];
-            else
-                it->second->f = root;
-            if (it->second->f->isWord)
-                it->second->output = it->second->f;
+            node *g = child(state, t->c);
+            t->f = g != NULL ? g : root;
+            if (t->f->isWord)
+                t->output = t->f;
             else   // may assign NULL pointer
-                it->second->output = it->second->f->output;
+                t->output = t->f->output;
         }
     }
 }
 
-// creates Aho-Corasick automaton from a dictionary
-node* ConstructAutomaton(VS &dictionary) {
-    size_t n = 0;
-    node *root = new node(n++);
+// creates Aho-Corasick automaton from a dictionary, allocating its nodes in
+// arena. Any automaton previously built in arena is released in one go, and
+// the arena's storage is reused when rebuilding.
+node* ConstructAutomaton(VS &dictionary, ac_arena &A) {
+    size_t total = 1;
+    for (size_t i = 0; i < dictionary.size(); ++i) total += dictionary[i].size();
+    A.nodes.clear(); A.nodes.reserve(total);
+    A.nodes.emplace_back(0);
+    A.words.resize(dictionary.size()); A.term.resize(dictionary.size());
     for (size_t i = 0; i < dictionary.size(); ++i) {
-        enter(dictionary[i], root, n);
+        enter(dictionary[i], i, A);
+    }
+    size_t off = 0;
+    for (size_t s = 0; s < A.nodes.size(); ++s) {
+        A.nodes[s].wbeg = A.nodes[s].wend = A.words.data() + off;
+        off += A.nodes[s].nwords;
     }
+    for (size_t i = 0; i < dictionary.size(); ++i) *A.nodes[A.term[i]].wend++ = i;
+    node *root = &A.nodes[0];
     construct_f(root);
     return root;
 }
 
 // returns a pointer to the next node after the character c is encountered
+// (does not modify the automaton, so it is safe to call from several threads)
 node* advance(node *state, char c) {
-    while (state->g.count(c) == 0 && state->num != 0) state = state->f;
-    if (state->g.count(c) != 0)
-        state = state->g[c];
-    return state;
+    node *t;
+    while ((t = child(state, c)) == NULL && state->num != 0)
+        state = state->f;
+    return t != NULL ? t : state;
 }
 
+typedef pair<size_t, size_t> II;
+typedef vector<II> VII;
+
+// A resumable matcher: the text may be fed in chunks of any size, and the
+// automaton state is kept between calls. Each match is reported as
+// report(i, id), where i is the global offset of the last matched character
+// and id the word's index in the dictionary.
+struct matcher {
+    node *root, *state;
+    size_t pos = 0;     // number of characters fed so far
+    matcher(node *root) : root(root), state(root) {}
+    void reset() { state = root; pos = 0; }
+    template<class F> void feed(const char *x, size_t len, F report) {
+        for (size_t i = 0; i < len; ++i, ++pos) {
+            state = advance(state, x[i]);
+            for (node *out = state; out != NULL; out = out->output)
+                for (size_t *w = out->wbeg; w != out->wend; ++w) report(pos, *w);
+        }
+    }
+    // appends matches to a caller-owned buffer, which may be reused across calls
+    void feed(const char *x, size_t len, VII &matches) {
+        feed(x, len, [&](size_t i, size_t id) { matches.push_back(II(i, id)); });
+    }
+};
+
 // prints all matches of dictionary words in the given query string
-void PrintMatches(node *root, string x) {
-    node *state = root;
+void PrintMatches(node *root, const string &x) {
+    matcher M(root);
+    M.feed(x.data(), x.size(), [](size_t i, size_t id) {
+        cout << i << " " << id << " " << endl;
+    });
+}
+
+// length of the longest dictionary word
+size_t MaxDepth(node *root) {
+    vector<pair<node*, size_t>> st(1, make_pair(root, 0));
+    size_t d = 0;
+    while (!st.empty()) {
+        node *r = st.back().first; size_t k = st.back().second; st.pop_back();
+        d = max(d, k);
+        for (node *t = r->child; t != NULL; t = t->sibling)
+            st.push_back(make_pair(t, k+1));
+    }
+    return d;
+}
+
+// Scans x[0..len-1] with the given number of threads and returns all matches
+// in the order PrintMatches would report them. Each thread owns the matches
+// ending in its segment, and starts from the root MaxDepth-1 characters early
+// so that no match is missed and none is reported twice.
+VII ParallelMatches(node *root, const char *x, size_t len, size_t threads) {
+    threads = max<size_t>(threads, 1);
+    size_t L = max<size_t>(MaxDepth(root), 1), seg = (len + threads - 1) / threads;
+    vector<VII> res(threads);
+    vector<thread> pool;
+    for (size_t k = 0; k < threads; ++k) pool.push_back(thread([&, k]() {
+        size_t b = min(len, k*seg), e = min(len, b + seg);
+        size_t s = b >= L ? b - (L-1) : 0;
+        matcher M(root); M.pos = s;
+        M.feed(x + s, e - s, [&](size_t i, size_t id) {
+            if (i >= b) res[k].push_back(II(i, id));
+        });
+    }));
+    VII all;
+    for (size_t k = 0; k < threads; ++k) {
+        pool[k].join();
+        all.insert(all.end(), res[k].begin(), res[k].end());
+    }
+    return all;
+}
+
+// Compiles the automaton rooted at root into a dense table: go[256*s+c] is the
+// state reached from state s on character c, with failure links folded in.
+// dict[s] is the first word state on the suffix chain of s (s included) and
+// link[s] the next one after s, or -1. States are numbered by node::num.
+// The dictionary indices of the words ending at state s are
+// words[woff[s] .. woff[s+1]-1].
+// Costs 256 ints per state, but scanning is one table lookup per character.
+struct dfa {
+    vector<int> go, dict, link;
+    VI woff, words;
+};
+
+dfa CompileAutomaton(node *root) {
+    vector<node*> order(1, root);   // BFS order, so f[s] precedes s
+    for (size_t i = 0; i < order.size(); ++i)
+        for (node *t = order[i]->child; t != NULL; t = t->sibling)
+            order.push_back(t);
+    size_t n = order.size();
+    dfa A; A.go.assign(256*n, 0); A.dict.assign(n, -1); A.link.assign(n, -1);
+    for (size_t i = 0; i < n; ++i) {
+        node *r = order[i];
+        int *row = &A.go[256*r->num];
+        if (i > 0) copy_n(&A.go[256*r->f->num], 256, row);
+        for (node *t = r->child; t != NULL; t = t->sibling)
+            row[(unsigned char)t->c] = t->num;
+        if (r->output != NULL) A.link[r->num] = r->output->num;
+        A.dict[r->num] = r->isWord ? r->num : A.link[r->num];
+    }
+    A.woff.assign(n+1, 0);
+    for (size_t i = 0; i < n; ++i) A.woff[order[i]->num + 1] = order[i]->wend - order[i]->wbeg;
+    for (size_t s = 0; s < n; ++s) A.woff[s+1] += A.woff[s];
+    A.words.resize(A.woff[n]);
+    for (size_t i = 0; i < n; ++i)
+        copy(order[i]->wbeg, order[i]->wend, A.words.begin() + A.woff[order[i]->num]);
+    return A;
+}
+
+// same output as PrintMatches, using the compiled automaton
+void PrintMatches(const dfa &A, const string &x) {
+    int state = 0;
     for (size_t i = 0; i < x.size(); ++i) {
-        state = advance(state, x[i]);
-        node *out = state;
-        while (true) {
-            if (out->isWord) cout << i << " " << out->num << " " << endl;
-            if (out->output == NULL) break;
-            out = out->output;
-        }
+        state = A.go[256*state + (unsigned char)x[i]];
+        for (int out = A.dict[state]; out != -1; out = A.link[out])
+            for (size_t k = A.woff[out]; k < A.woff[out+1]; ++k)
+                cout << i << " " << A.words[k] << " " << endl;
     }
 }
 
@@ -109,15 +253,46 @@ string randString(size_t length) {
 }
 
 int main() {
+    static_assert(is_trivially_destructible<node>::value, "nodes must not own memory");
     srand(0);
     {
         VS dictionary = {"a", "ab", "bab", "bc", "bca", "c", "caa"};
-        node *root = ConstructAutomaton(dictionary);
+        ac_arena arena;
+        node *root = ConstructAutomaton(dictionary, arena);
         
-        cout << "Expected:\n0 1\n1 2\n2 6\n2 8\n3 8\n4 1\n5 2" << endl;
+        cout << "Expected:\n0 0\n1 1\n2 3\n2 5\n3 5\n4 0\n5 1" << endl;
         cout << "Actual:" << endl;
 
         PrintMatches(root, "abccab");
+
+        cout << "Compiled:" << endl;
+        dfa A = CompileAutomaton(root);
+        PrintMatches(A, "abccab");
+
+        VII expected = {II(0,0), II(1,1), II(2,3), II(2,5), II(3,5), II(4,0), II(5,1)};
+        string x = "abccab";
+        for (size_t chunk = 1; chunk <= x.size(); ++chunk) {
+            matcher M(root);
+            VII matches;
+            for (size_t i = 0; i < x.size(); i += chunk)
+                M.feed(x.data() + i, min(chunk, x.size() - i), matches);
+            if (matches != expected)
+                cerr << "matcher fed in chunks of " << chunk << " reported wrong matches" << endl;
+        }
+        for (size_t threads = 0; threads <= 8; ++threads) {
+            if (ParallelMatches(root, x.data(), x.size(), threads) != expected)
+                cerr << "ParallelMatches with " << threads << " threads reported wrong matches" << endl;
+        }
+    }
+    {
+        // repeated words are all reported, by their own index
+        VS dictionary = {"ab", "b", "ab"};
+        ac_arena arena;
+        node *root = ConstructAutomaton(dictionary, arena);
+        VII matches, expected = {II(1,0), II(1,2), II(1,1)};
+        matcher(root).feed("ab", 2, matches);
+        if (matches != expected)
+            cerr << "matcher reported wrong word indices for a repeated word" << endl;
     }
     {
         VS dictionary;
@@ -127,12 +302,59 @@ int main() {
 
         cout << "Speed Test" << endl;
         cout << "Constructing Automaton..." << endl;
-        node *root = ConstructAutomaton(dictionary);
+        ac_arena arena;
+        node *root = ConstructAutomaton(dictionary, arena);
         
+        cout << "Complete. Rebuilding in the same arena..." << endl;
+        const node *old = arena.nodes.data();
+        root = ConstructAutomaton(dictionary, arena);
+        if (arena.nodes.data() != old)
+            cerr << "rebuilding in the same arena reallocated the nodes" << endl;
+
         cout << "Complete. Querying..." << endl;
         for (size_t i = 0; i < 10; ++i) {
             PrintMatches(root, randString(1000000));
         }
+        size_t threads = max(1u, thread::hardware_concurrency());
+        cout << "Complete. Querying with " << threads << " threads..." << endl;
+        for (size_t i = 0; i < 10; ++i) {
+            string x = randString(1000000);
+            VII matches = ParallelMatches(root, x.data(), x.size(), threads);
+        }
+        cout << "Complete" << endl;
+    }
+    {
+        VS dictionary;
+        for (size_t i = 0; i < 200; ++i) {
+            dictionary.push_back(randString(1 + rand()%3));
+        }
+        ac_arena arena;
+        node *root = ConstructAutomaton(dictionary, arena);
+        string x = randString(100000);
+        VII expected;
+        matcher(root).feed(x.data(), x.size(), expected);
+        for (size_t threads = 1; threads <= 16; ++threads) {
+            if (ParallelMatches(root, x.data(), x.size(), threads) != expected)
+                cerr << "ParallelMatches with " << threads << " threads disagrees with matcher" << endl;
+        }
+    }
+    {
+        // the dense table needs 1KB per state, so use a smaller dictionary
+        VS dictionary;
+        for (size_t i = 0; i < 1000; ++i) {
+            dictionary.push_back(randString(50));
+        }
+
+        cout << "Compiled Speed Test" << endl;
+        cout << "Constructing Automaton..." << endl;
+        ac_arena arena;
+        node *root = ConstructAutomaton(dictionary, arena);
+        dfa A = CompileAutomaton(root);
+
+        cout << "Complete. Querying..." << endl;
+        for (size_t i = 0; i < 10; ++i) {
+            PrintMatches(A, randString(1000000));
+        }
         cout << "Complete" << endl;
     }
     // code has been successfully tested on SWERC '16 "Passwords"
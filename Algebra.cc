@@ -163,7 +163,7 @@ T mult_mod(T a, T b, T m) {
     asm(
             "mulq %3;"
             "divq %4;"
-            : "=a"(q), "=d"(r)
+            : "=a"(q), "=&d"(r)
             : "a"(a), "rm"(b), "rm"(m));
     return r;
 }
@@ -1,102 +1,183 @@
 #include <vector>
 #include <algorithm>
 #include <iostream>
-#include <stack>
+#include "CSRGraph.cc"
 using namespace std;
 #define FOR(v,l,u) for( size_t v = l; v < u; ++v )
 // BEGIN
 // This is code for computing articulation points of graphs,
 // ie points whose removal increases the number of components in the graph.
 // This works when the given graph is not necessarily connected, too.
+// comp_artbridge also finds the bridges and the biconnected components
+// (blocks; an isolated vertex is a block by itself) in the same pass.
+// Adj is the adjacency type; artbridge_graph_t<csr_rows<size_t>> runs on the
+// adj() view of an undirected csr_graph (see CSRGraph.cc).
 typedef vector<size_t> VI;
 typedef vector<VI>     VVI;
 typedef vector<bool>   VB;
 typedef pair<size_t, size_t> II;
 typedef vector<II> VII;
 
-struct artbridge_graph {
-    size_t N;     VVI adj;        // basic graph stuff
+template<class Adj = VVI> struct artbridge_graph_t {
+    size_t N;     Adj adj;        // basic graph stuff
     VI  parent, n_children, rank; // dfs tree
     VB  is_art;   VI reach;       // articulation points
     VII bridges;              // bridges
     VB visited; size_t R;
-    artbridge_graph( size_t N ) : N(N), adj(N), is_art(N) {}
+    VI it, stk, vstk; size_t vs; VB skip_par;   // explicit dfs stack
+    size_t n_bcc; VI bcc_off, bcc_nodes;        // block b is bcc_nodes[bcc_off[b] .. bcc_off[b+1]-1]
+    artbridge_graph_t( size_t N ) : N(N), adj(N), is_art(N) {}
+    artbridge_graph_t( const Adj &adj ) : N(adj.size()), adj(adj), is_art(N) {}
     void add_edge( size_t s, size_t t ) {
         adj[s].push_back(t);
         adj[t].push_back(s);
     }
-    void dfs_artpts( size_t rt ) {
-        visited[rt] = true;
-        rank[rt] = R++;
-        reach[rt] = rank[rt];
-        FOR(i,0,adj[rt].size()) {
-            size_t v = adj[rt][i];
-            if( v == parent[rt] ) continue;
-            if( visited[v] )
-                reach[rt] = min(reach[rt], rank[v]);
-            else {
-                ++n_children[rt];
-                parent[v] = rt;
-                dfs_artpts( v );
-                reach[rt] = min(reach[rt], reach[v]);
-                if (reach[v] >= rank[rt])
-                    is_art[rt] = true;
-                if (reach[v] > rank[rt])
-                    bridges.push_back(II(min(rt, v), max(rt, v)));
-            }
-        }
+    // Hopcroft-Tarjan with an explicit stack: it[v] is the next edge of v to
+    // look at, stk holds the dfs path and vstk the vertices not yet assigned
+    // to a block, so no recursion and no allocation once comp_artbridge has
+    // sized the arrays. Only the first edge back to the parent is skipped, so
+    // parallel edges are never bridges. Each tree edge is checked once when
+    // its child finishes, so every bridge is reported once, as (min, max).
+    void visit( size_t v ) {
+        visited[v] = true;   rank[v] = reach[v] = R++;   vstk[vs++] = v;
     }
-    // an iterative version. Should not be needed if environment is set up right.
-    void dfs_artpts_it( size_t rt) {
-        stack<size_t> s;
-        s.push(rt);
-        while (!s.empty()) {
-            size_t cur = s.top();
-            if (!visited[cur]) {
-                visited[cur] = true;
-                rank[cur] = R++;
-                reach[cur] = rank[cur];
-            }
-            bool done = true;
-            FOR(i,0,adj[cur].size()) {
-                size_t v = adj[cur][i];
-                if (v == parent[cur]) continue;
-                if (visited[v]) {
-                    reach[cur] = min(reach[cur], rank[v]);
-                    if (parent[v] == cur) {
-                        reach[cur] = min(reach[cur], reach[v]);
-                    }
-                }
-                else {
-                    done = false;
-                    ++n_children[cur];
-                    parent[v] = cur;
-                    s.push(v);
-                    break;
-                }
-                if (reach[v] >= rank[cur])
-                    is_art[cur] = true;
-                if (reach[v] > rank[cur])   //this might create duplicates
-                    bridges.push_back(II(min(cur, v), max(cur, v)));
+    // pops the block whose top-most vertex below u is v (or u alone if v == N)
+    void emit_block( size_t u, size_t v ) {
+        if( v != N ) do bcc_nodes.push_back(vstk[--vs]); while( bcc_nodes.back() != v );
+        else --vs;
+        bcc_nodes.push_back(u);   bcc_off.push_back(bcc_nodes.size());   ++n_bcc;
+    }
+    void dfs_artpts( size_t rt ) {
+        size_t sp = 0;   stk[sp++] = rt;   visit(rt);
+        while( sp ) {
+            size_t u = stk[sp-1];
+            if( it[u] < adj[u].size() ) {
+                size_t v = adj[u][it[u]++];
+                if( v == parent[u] && !skip_par[u] ) { skip_par[u] = true; continue; }
+                if( visited[v] ) reach[u] = min(reach[u], rank[v]);
+                else { ++n_children[u];   parent[v] = u;   visit(v);   stk[sp++] = v; }
+                continue;
             }
-            if (done)
-                s.pop();
+            if( --sp == 0 ) { if( n_children[u] == 0 ) emit_block(u, N); else --vs; continue; }
+            size_t p = parent[u];
+            reach[p] = min(reach[p], reach[u]);
+            if( reach[u] >= rank[p] ) { is_art[p] = true;   emit_block(p, u); }
+            if( reach[u] > rank[p] ) bridges.push_back(II(min(p, u), max(p, u)));
         }
     }
     void comp_artbridge() {
         is_art = VB(N, false);  reach = VI(N);
         parent = VI(N,N);      rank = VI(N);      n_children = VI(N,0);
         visited = VB(N,false);   R = 0;
+        it = VI(N,0);   stk = VI(N);   vstk = VI(N);   vs = 0;   skip_par = VB(N,false);
+        bridges.clear();   n_bcc = 0;   bcc_off = VI(1,0);   bcc_nodes.clear();
         FOR(i,0,N) {
             if( visited[i] ) continue;
             dfs_artpts(i); // this is not right on i
             is_art[i] = (n_children[i] >= 2); // but we can fix it!
         }
     }
+    // The block-cut tree (a forest if the graph is disconnected): node v < N
+    // is vertex v, node N+b is block b, with an edge between v and N+b when v
+    // lies in block b. Articulation points are exactly the vertices of degree
+    // at least 2. Call after comp_artbridge.
+    csr_graph<> block_cut_tree() const {
+        vector<pair<size_t,size_t>> edges;
+        FOR(b,0,n_bcc) FOR(i,bcc_off[b],bcc_off[b+1]) edges.push_back(II(bcc_nodes[i], N+b));
+        return csr_graph<>(N + n_bcc, edges, vector<long long>(), true);
+    }
+};
+typedef artbridge_graph_t<> artbridge_graph;
+
+// Bridges and 2-edge-connectivity under edge insertions. The 2-edge-connected
+// components (2ECCs) are kept in the union-find ecc, and the bridges form a
+// forest on them with parent pointers par (on 2ECC representatives) whose
+// trees are tracked by the union-find cc (both stored as in UnionFind.cc,
+// C[i] = parent of i). Linking two trees re-roots the smaller one; an edge
+// inside a tree merges the 2ECCs on the tree path, found by walking up from
+// both ends in lock step. O(log N) amortized per edge.
+struct bridge_tracker {
+    size_t N, n_bridges;
+    VI ecc, cc, cc_size, par, last, path[2];  size_t iter;
+    bridge_tracker( size_t N ) : N(N), n_bridges(0), ecc(N), cc(N), cc_size(N,1), par(N,N), last(N,0), iter(0) {
+        FOR(v,0,N) ecc[v] = cc[v] = v;
+    }
+    // seeded with the edges of G, which must have run comp_artbridge: each
+    // bridge-free component is labelled by a search, then the bridges link them
+    template<class Adj> bridge_tracker( const artbridge_graph_t<Adj> &G ) : bridge_tracker(G.N) {
+        VII br(G.bridges);   sort(br.begin(), br.end());
+        VB seen(N, false);   VI q;
+        FOR(s,0,N) {
+            if( seen[s] ) continue;
+            seen[s] = true;   q.assign(1, s);
+            while( !q.empty() ) {
+                size_t u = q.back();   q.pop_back();
+                FOR(i,0,G.adj[u].size()) {
+                    size_t v = G.adj[u][i];
+                    if( seen[v] || binary_search(br.begin(), br.end(), II(min(u,v), max(u,v))) ) continue;
+                    seen[v] = true;   ecc[v] = s;   q.push_back(v);
+                }
+            }
+        }
+        FOR(i,0,br.size()) add_edge(br[i].first, br[i].second);
+    }
+    // find with path compression, iterative since merge_path and the
+    // re-rooting can leave long chains
+    static size_t root( VI &C, size_t x ) {
+        size_t r = x;
+        while( C[r] != r ) r = C[r];
+        while( C[x] != r ) { size_t y = C[x];   C[x] = r;   x = y; }
+        return r;
+    }
+    size_t find_2ecc( size_t v ) { return root(ecc, v); }
+    size_t find_cc( size_t v ) { return root(cc, find_2ecc(v)); }
+    bool two_edge_connected( size_t u, size_t v ) { return find_2ecc(u) == find_2ecc(v); }
+    bool connected( size_t u, size_t v ) { return find_cc(u) == find_cc(v); }
+    // for an edge (u, v) of the graph
+    bool is_bridge( size_t u, size_t v ) { return !two_edge_connected(u, v); }
+    // makes the 2ECC of v the root of its bridge tree
+    void make_root( size_t v ) {
+        v = find_2ecc(v);
+        size_t root = v, child = N;
+        while( v != N ) {
+            size_t p = par[v] == N ? N : find_2ecc(par[v]);
+            par[v] = child;   cc[v] = root;
+            child = v;   v = p;
+        }
+        cc_size[root] = cc_size[child];
+    }
+    void merge_path( size_t a, size_t b ) {
+        size_t x[2] = {a, b}, lca = N;
+        path[0].clear();   path[1].clear();   ++iter;
+        while( lca == N ) FOR(k,0,2) if( x[k] != N && lca == N ) {
+            x[k] = find_2ecc(x[k]);   path[k].push_back(x[k]);
+            if( last[x[k]] == iter ) lca = x[k];
+            last[x[k]] = iter;   x[k] = par[x[k]];
+        }
+        FOR(k,0,2) FOR(i,0,path[k].size()) {
+            size_t v = path[k][i];
+            ecc[v] = lca;
+            if( v == lca ) break;
+            --n_bridges;
+        }
+    }
+    void add_edge( size_t a, size_t b ) {
+        a = find_2ecc(a);   b = find_2ecc(b);
+        if( a == b ) return;
+        size_t ca = find_cc(a), cb = find_cc(b);
+        if( ca != cb ) {
+            ++n_bridges;
+            if( cc_size[ca] > cc_size[cb] ) { swap(a, b);   swap(ca, cb); }
+            make_root(a);
+            par[a] = cc[a] = b;
+            cc_size[cb] += cc_size[a];
+        } else merge_path(a, b);
+    }
 };
 // END
 
 #include<set>
+#include "UnionFind.cc"   // merge and find, for the brute-force tests
 
 void test_artpts_correct() {
     cerr << "test correctness" << endl;
@@ -218,21 +299,144 @@ void test_artpts_correct() {
     }
 }
 
-void test_artpts_stack() {
+// number of components of G without vertex x (x = N to keep every vertex)
+size_t count_components( const artbridge_graph &G, size_t x ) {
+    VB seen(G.N, false);   size_t ct = 0;
+    FOR(s,0,G.N) {
+        if( s == x || seen[s] ) continue;
+        ++ct;   VI q(1, s);   seen[s] = true;
+        while( !q.empty() ) {
+            size_t u = q.back(); q.pop_back();
+            FOR(i,0,G.adj[u].size()) {
+                size_t v = G.adj[u][i];
+                if( v == x || seen[v] ) continue;
+                seen[v] = true;   q.push_back(v);
+            }
+        }
+    }
+    return ct;
+}
+
+void test_artpts_random() {
+    cerr << "test against brute force" << endl;
+    FOR(t,0,300) {
+        size_t n = 1 + rand()%12, m = rand()%(2*n);
+        artbridge_graph G(n);
+        VII edges;
+        FOR(i,0,m) { size_t a = rand()%n, b = rand()%n; if( a == b ) continue; G.add_edge(a,b); edges.push_back(II(a,b)); }
+        G.comp_artbridge();
+        size_t base = count_components(G, n);
+        FOR(v,0,n) {
+            size_t c = count_components(G, v) + (G.adj[v].empty() ? 1 : 0);
+            if( G.is_art[v] != (c > base) ) cerr << "(random test #" << t << ") wrong about vertex " << v << endl;
+        }
+        // edge (a,b) is a bridge iff removing one copy disconnects a from b
+        set<II> expect;
+        FOR(i,0,edges.size()) {
+            artbridge_graph H(n);
+            FOR(j,0,edges.size()) if( j != i ) H.add_edge(edges[j].first, edges[j].second);
+            if( count_components(H, n) > base ) expect.insert(II(min(edges[i].first, edges[i].second), max(edges[i].first, edges[i].second)));
+        }
+        if( set<II>(G.bridges.begin(), G.bridges.end()) != expect || G.bridges.size() != expect.size() ) {
+            cerr << "(random test #" << t << ") wrong or duplicate bridges" << endl;
+        }
+        // every edge lies in exactly one block, every vertex in one block unless
+        // it is an articulation point, and the block-cut tree is a forest with
+        // one tree per component
+        VI in_blocks(n, 0);
+        FOR(b,0,G.n_bcc) FOR(i,G.bcc_off[b],G.bcc_off[b+1]) ++in_blocks[G.bcc_nodes[i]];
+        FOR(v,0,n) if( (in_blocks[v] > 1) != G.is_art[v] || in_blocks[v] == 0 ) {
+            cerr << "(random test #" << t << ") vertex " << v << " is in " << in_blocks[v] << " blocks" << endl;
+        }
+        FOR(i,0,edges.size()) {
+            size_t ct = 0;
+            FOR(b,0,G.n_bcc) {
+                bool x = false, y = false;
+                FOR(j,G.bcc_off[b],G.bcc_off[b+1]) { x |= G.bcc_nodes[j] == edges[i].first; y |= G.bcc_nodes[j] == edges[i].second; }
+                ct += x && y;
+            }
+            if( ct != 1 ) cerr << "(random test #" << t << ") edge in " << ct << " blocks" << endl;
+        }
+        csr_graph<> T = G.block_cut_tree();
+        if( T.to.size()/2 + base != T.N ) cerr << "(random test #" << t << ") block-cut tree is not a forest" << endl;
+    }
+}
+
+void test_bridge_tracker() {
+    cerr << "test bridge_tracker against recomputing" << endl;
+    FOR(t,0,200) {
+        size_t n = 1 + rand()%15, m0 = rand()%n, m1 = rand()%(2*n);
+        artbridge_graph G(n);
+        FOR(i,0,m0) G.add_edge(rand()%n, rand()%n);
+        G.comp_artbridge();
+        bridge_tracker B(G);
+        FOR(i,0,m1) {
+            size_t a = rand()%n, b = rand()%n;
+            G.add_edge(a, b);   B.add_edge(a, b);
+            G.comp_artbridge();
+            if( B.n_bridges != G.bridges.size() ) {
+                cerr << "(tracker test #" << t << ") " << B.n_bridges << " bridges instead of " << G.bridges.size() << endl;
+            }
+            // 2-edge-connected iff connected once the bridges are removed
+            sort(G.bridges.begin(), G.bridges.end());
+            VI C(n);
+            FOR(v,0,n) C[v] = v;
+            FOR(u,0,n) FOR(j,0,G.adj[u].size()) {
+                size_t v = G.adj[u][j];
+                if( !binary_search(G.bridges.begin(), G.bridges.end(), II(min(u,v), max(u,v))) ) merge(C, u, v);
+            }
+            FOR(u,0,n) FOR(v,0,n) if( B.two_edge_connected(u, v) != (find(C, u) == find(C, v)) ) {
+                cerr << "(tracker test #" << t << ") wrong about " << u << " and " << v << endl;
+            }
+        }
+    }
+}
+
+void test_bridge_tracker_long() {
+    const size_t N = 1000000;
+    cerr << "test bridge_tracker on a cycle and a path with " << N << " nodes" << endl;
     {
-        cerr << "Testing stackoverflow" << endl;
-        cerr << "This should not segfault if system environment is set up correctly" << endl;
-        //cerr << "Run command \"ulimit -s 268435456\"" << endl;
-        cerr << "Run command \"ulimit -s 262144\" for codeforces stack size" << endl;
-        cerr << "Run command \"ulimit -s 2064888\" for ICPC World Finals stack size" << endl;
-        cerr << "Run command \"ulimit -s hard\" for maximum stack on current system" << endl;
-        //size_t N = 650000;
-        size_t N = 65000;
         artbridge_graph G(N);
-        for (size_t i = 0; i < N-1; ++i) {
-            G.add_edge(i, i+1);
-        }
+        FOR(i,0,N) G.add_edge(i, (i+1) % N);
         G.comp_artbridge();
+        bridge_tracker B(G);
+        if( B.n_bridges != 0 || !B.two_edge_connected(0, N-1) ) cerr << "bridge_tracker is wrong on a cycle" << endl;
+    }
+    {
+        artbridge_graph G(N);
+        FOR(i,1,N) G.add_edge(i-1, i);
+        G.comp_artbridge();
+        bridge_tracker B(G);
+        if( B.n_bridges != N-1 ) cerr << "bridge_tracker is wrong on a path" << endl;
+        for( size_t i = 0; i+2 < N; i += 2 ) B.add_edge(i, i+2);   // merges up the path one step at a time
+        if( B.n_bridges != (N-1) % 2 || !B.two_edge_connected(0, N - 2 + N % 2) ) {
+            cerr << "bridge_tracker is wrong after closing a path" << endl;
+        }
+    }
+}
+
+void test_bridge_tracker_speed() {
+    const size_t N = 1000000, M = 3000000;
+    cerr << "Start bridge_tracker speed test... N = " << N << ", " << N-1 << " tree edges, " << M << " insertions" << endl;
+    artbridge_graph G(N);
+    FOR(i,1,N) G.add_edge(i, rand()%i);
+    G.comp_artbridge();
+    bridge_tracker B(G);
+    FOR(i,0,M) B.add_edge(rand()%N, rand()%N);
+    cerr << "End speed test, " << B.n_bridges << " bridges left." << endl;
+}
+
+void test_artpts_stack() {
+    const size_t N = 10000000;
+    cerr << "Start test on a path with " << N << " nodes..." << endl;
+    artbridge_graph G(N);
+    for (size_t i = 0; i < N-1; ++i) {
+        G.add_edge(i, i+1);
+    }
+    G.comp_artbridge();
+    cerr << "End test." << endl;
+    if( G.bridges.size() != N-1 || G.n_bcc != N-1 ) {
+        cerr << "path has " << G.bridges.size() << " bridges and " << G.n_bcc << " blocks" << endl;
     }
 }
 
@@ -249,10 +453,29 @@ void test_artpts_speed() {
     delete G;
 }
 
+void test_artpts_csr() {
+    cerr << "test on a csr_graph" << endl;
+    vector<pair<size_t,size_t>> edges = {{0,1}, {1,2}, {2,0}, {1,4}, {4,3}, {3,1}, {4,5}, {5,7}, {5,6}};
+    artbridge_graph G(8);
+    FOR(i,0,edges.size()) G.add_edge(edges[i].first, edges[i].second);
+    G.comp_artbridge();
+    csr_graph<> C(8, edges, vector<long long>(), true);
+    artbridge_graph_t<csr_rows<size_t>> H(C.adj());
+    H.comp_artbridge();
+    if( G.is_art != H.is_art || G.bridges != H.bridges ) {
+        cerr << "articulation points or bridges on csr_graph differ from artbridge_graph" << endl;
+    }
+}
+
 int main() {
     test_artpts_correct();
+    test_artpts_csr();
+    test_artpts_random();
+    test_bridge_tracker();
+    test_bridge_tracker_long();
     test_artpts_stack();
     test_artpts_speed();
+    test_bridge_tracker_speed();
     return 0;
 }
 
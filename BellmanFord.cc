@@ -1,14 +1,40 @@
+#ifndef BELLMANFORD_CC
+#define BELLMANFORD_CC
 #include <vector>
 #include <limits>
+#include <deque>
+#include <algorithm>
+#include "CSRGraph.cc"
+#include "ThreadPool.cc"
 using namespace std;
 // BEGIN
 // A Bellman-Ford implementation.
 // bellmanford(S) computes the shortest paths from S to all other nodes.
-// It returns true if there are no negative cycles in the graph,
-// and false otherwise.
+// It returns true if there are no negative cycles reachable from S,
+// and false otherwise, in which case cycle holds one of them (the edges
+// cycle[i] -> cycle[i+1], wrapping around) and D is meaningless.
 // D[v] is set to the shortest path from S to v (when it exists).
 // P[v] is set to the parent of v in the shortest-paths tree,
 // or N (for which there is no index) if v is not reachable from S.
+// It stops as soon as a round changes nothing.
+// spfa(S) computes the same thing with a work queue of the nodes whose
+// distance dropped (Shortest Path Faster Algorithm), with the SLF and LLL
+// heuristics: a node goes to the front if it beats the current front, and
+// the front is moved to the back while it is above the queue average.
+// Every N relaxations it checks the parent graph for a cycle, which is then
+// a negative cycle. Usually much faster, but O(N E) in the worst case too.
+// bellmanford_parallel(S, threads) runs synchronous rounds on a flat list of
+// in-edges grouped by target (in_off, in_src, in_w): each thread owns a range
+// of targets and writes only those, reading last round's distances, so there
+// are no atomics and the result does not depend on scheduling. A round only
+// rescans the targets of nodes that changed in the previous one (all nodes
+// when those have more than E/8 out-edges), and small rounds run on the
+// caller, so long paths cost O(E) rather than O(N E). One thread_pool (see
+// ThreadPool.cc) serves every round; threads == 0 is taken as 1. D is the
+// same as bellmanford's; P is a shortest-path tree too, but on ties it may
+// pick a different parent.
+// bellmanford_graph_t<csr_rows<size_t>, csr_rows<T>> runs on the adj() and
+// weights() views of a csr_graph<T> (see CSRGraph.cc).
 #define FOR(v,l,u) for( size_t v = l; v < u; ++v )
 typedef signed long long int T;
 typedef vector<T>       VT;
@@ -17,44 +43,151 @@ typedef vector<bool>    VB;
 typedef vector<VB>     VVB;
 typedef vector<size_t>  VI;
 typedef vector<VI>     VVI;
-const T UNBOUNDED = numeric_limits<T>::min(); // -infinity for doubles
 const T INFINITY  = numeric_limits<T>::max(); // infinity for doubles
 
-struct bellmanford_graph {
+template<class Adj = VVI, class WAdj = VVT> struct bellmanford_graph_t {
 	size_t N; // number of nodes
-	VVI    A; // adjacency list
-	VVT    W; // weight of edges
+	Adj    A; // adjacency list
+	WAdj   W; // weight of edges
 	VT     D; // shortest distance
 	VI     P; // parent in the shortest path tree
-	bellmanford_graph( size_t N ) : N(N), A(N), W(N) {}
+	bellmanford_graph_t( size_t N ) : N(N), A(N), W(N) {}
+	bellmanford_graph_t( const Adj &A, const WAdj &W ) : N(A.size()), A(A), W(W) {}
 	void add_edge( size_t s, size_t t, T w ) {
 		A[s].push_back(t);
 		W[s].push_back(w);
 	}
+	VI     cycle; // a negative cycle, if there is one
+	VI     mark;
+	// walks the parent pointers from x, which must end on a cycle, and sets cycle
+	void extract_cycle( size_t x ) {
+		cycle.clear();
+		for( size_t v = x; ; v = P[v] ) { cycle.push_back(v); if( P[v] == x ) break; }
+		reverse(cycle.begin(), cycle.end());
+	}
+	// a node on a cycle of the parent graph, or N if there is none
+	size_t parent_cycle() {
+		mark.assign(N, N);
+		FOR(s,0,N) {
+			size_t v = s;
+			while( v != N && mark[v] == N ) { mark[v] = s;   v = P[v]; }
+			if( v != N && mark[v] == s ) return v;
+		}
+		return N;
+	}
 	bool bellmanford( size_t S ) {
-		D = VT(N, INFINITY); D[S] = 0; P = VI(N,N);
-		FOR(k,0,N)
-		FOR(s,0,N)
-		FOR(i,0,A[s].size()) {
-			size_t t = A[s][i];
-			if( D[s] == INFINITY ) continue;
-			if( D[t] > D[s] + W[s][i] ) {
-				if( k == N-1 ) {
-					D[t] = UNBOUNDED;
+		D = VT(N, INFINITY); D[S] = 0; P = VI(N,N); cycle.clear();
+		FOR(k,0,N) {
+			size_t x = N;
+			FOR(s,0,N) {
+				if( D[s] == INFINITY ) continue;
+				FOR(i,0,A[s].size()) {
+					size_t t = A[s][i];
+					if( D[t] > D[s] + W[s][i] ) {
+						D[t] = D[s] + W[s][i];
+						P[t] = s;   x = t;
+					}
 				}
-				else {
-					D[t] = D[s] + W[s][i];
-					P[t] = s;
+			}
+			if( x == N ) return true;
+			if( k == N-1 ) {   // still relaxing after N-1 rounds
+				FOR(i,0,N) x = P[x];
+				extract_cycle(x);
+			}
+		}
+		return false;
+	}
+	bool spfa( size_t S ) {
+		D = VT(N, INFINITY); D[S] = 0; P = VI(N,N); cycle.clear();
+		deque<size_t> Q(1, S);
+		VB in_q(N, false);   in_q[S] = true;
+		long double sum = 0;   // of D over Q; distances near 2^63 would overflow a T
+		size_t relaxed = 0;
+		while( !Q.empty() ) {
+			// at most one full turn, in case rounding puts every node above the average
+			for( size_t r = Q.size(); r > 0 && (long double)Q.size() * D[Q.front()] > sum; --r ) {
+				Q.push_back(Q.front());   Q.pop_front();
+			}
+			size_t s = Q.front();   Q.pop_front();   in_q[s] = false;   sum -= D[s];
+			FOR(i,0,A[s].size()) {
+				size_t t = A[s][i];
+				if( D[t] <= D[s] + W[s][i] ) continue;
+				if( in_q[t] ) sum -= D[t];
+				D[t] = D[s] + W[s][i];   P[t] = s;
+				if( ++relaxed % N == 0 ) {
+					size_t x = parent_cycle();
+					if( x != N ) { extract_cycle(x); return false; }
 				}
+				if( in_q[t] ) { sum += D[t]; continue; }
+				if( !Q.empty() && D[t] < D[Q.front()] ) Q.push_front(t);
+				else Q.push_back(t);
+				in_q[t] = true;   sum += D[t];
 			}
 		}
-		FOR(v,0,N) if( D[v] == UNBOUNDED ) return false;
 		return true;
 	}
+	VI     in_off, in_src; // in-edges of t are in_src[in_off[t] .. in_off[t+1]-1]
+	VT     in_w;           // with weights in_w[...]
+	void build_in_edges() {
+		in_off.assign(N+1, 0);
+		FOR(s,0,N) FOR(i,0,A[s].size()) ++in_off[A[s][i]+1];
+		FOR(v,0,N) in_off[v+1] += in_off[v];
+		in_src.resize(in_off[N]);   in_w.resize(in_off[N]);
+		VI pos(in_off.begin(), in_off.end()-1);
+		FOR(s,0,N) FOR(i,0,A[s].size()) {
+			size_t k = pos[A[s][i]]++;
+			in_src[k] = s;   in_w[k] = W[s][i];
+		}
+	}
+	bool bellmanford_parallel( size_t S, size_t threads ) {
+		build_in_edges();
+		D = VT(N, INFINITY); D[S] = 0; P = VI(N,N); cycle.clear();
+		thread_pool pool(threads);
+		VT next(N);
+		VI F(1, S), tgt, seen(N, N);   // changed last round, targets to rescan, round t was queued in
+		vector<VI> changed(pool.threads);
+		FOR(k,0,N) {
+			size_t out = 0;
+			FOR(i,0,F.size()) out += A[F[i]].size();
+			bool dense = out > in_off[N] / 8;
+			tgt.clear();
+			if( !dense ) FOR(i,0,F.size()) FOR(j,0,A[F[i]].size()) {
+				size_t t = A[F[i]][j];
+				if( seen[t] != k ) { seen[t] = k;   tgt.push_back(t); }
+			}
+			split_range(&pool, dense ? N : tgt.size(), [&](size_t th, size_t lo, size_t hi) {
+				FOR(j,lo,hi) {
+					size_t t = dense ? j : tgt[j];
+					T d = D[t];   size_t p = P[t];
+					FOR(i,in_off[t],in_off[t+1]) {
+						T ds = D[in_src[i]];
+						if( ds != INFINITY && d > ds + in_w[i] ) { d = ds + in_w[i];   p = in_src[i]; }
+					}
+					if( d != D[t] ) { next[t] = d;   P[t] = p;   changed[th].push_back(t); }
+				}
+			});
+			F.clear();
+			FOR(th,0,pool.threads) {
+				FOR(i,0,changed[th].size()) { size_t t = changed[th][i];   D[t] = next[t];   F.push_back(t); }
+				changed[th].clear();
+			}
+			if( F.empty() ) return true;
+			if( k == N-1 ) {
+				size_t x = F.back();
+				FOR(i,0,N) x = P[x];
+				extract_cycle(x);
+			}
+		}
+		return false;
+	}
 };
+typedef bellmanford_graph_t<> bellmanford_graph;
 // END
 
+#ifdef BUILD_TEST_BELLMANFORD
 #include <iostream>
+#include <string>
+#include <chrono>
 
 void test_bellmanford_correct() {
 	cerr << "test bellmanford_graph correctness" << endl;
@@ -111,6 +244,86 @@ void test_bellmanford_correct() {
 	}
 }
 
+// weight of the cheapest edge s -> t, or INFINITY if there is none
+T edge_weight( const bellmanford_graph &G, size_t s, size_t t ) {
+	T w = INFINITY;
+	FOR(i,0,G.A[s].size()) if( G.A[s][i] == t ) w = min(w, G.W[s][i]);
+	return w;
+}
+
+// checks D, P against a shortest-path tree, or cycle against a negative cycle
+void check_result( const bellmanford_graph &G, size_t S, bool ok, const VT &expect, const string &name, size_t t ) {
+	if( ok ) {
+		if( G.D != expect ) cerr << "(random test #" << t << ") " << name << " got wrong distances" << endl;
+		FOR(v,0,G.N) if( v != S && G.D[v] != INFINITY && G.D[v] != G.D[G.P[v]] + edge_weight(G, G.P[v], v) ) {
+			cerr << "(random test #" << t << ") " << name << " got a bad parent for " << v << endl;
+		}
+		return;
+	}
+	T w = 0;
+	FOR(i,0,G.cycle.size()) {
+		T e = edge_weight(G, G.cycle[i], G.cycle[(i+1) % G.cycle.size()]);
+		if( e == INFINITY ) { cerr << "(random test #" << t << ") " << name << " cycle uses a missing edge" << endl; return; }
+		w += e;
+	}
+	if( G.cycle.empty() || w >= 0 ) cerr << "(random test #" << t << ") " << name << " cycle is not negative" << endl;
+}
+
+void test_bellmanford_random() {
+	cerr << "test bellmanford, spfa and bellmanford_parallel against Floyd-Warshall" << endl;
+	FOR(t,0,500) {
+		size_t n = 1 + rand()%12, m = rand()%(3*n);
+		bellmanford_graph G(n);
+		VVT F(n, VT(n, INFINITY));
+		FOR(v,0,n) F[v][v] = 0;
+		FOR(i,0,m) {
+			size_t a = rand()%n, b = rand()%n;
+			T w = rand()%20 - (t%2 ? 3 : 0);
+			G.add_edge(a, b, w);
+			F[a][b] = min(F[a][b], w);
+		}
+		FOR(k,0,n) FOR(i,0,n) FOR(j,0,n)
+			if( F[i][k] != INFINITY && F[k][j] != INFINITY ) F[i][j] = min(F[i][j], F[i][k] + F[k][j]);
+		bool neg = false;
+		FOR(v,0,n) if( F[0][v] != INFINITY && F[v][v] < 0 ) neg = true;
+		bool ok1 = G.bellmanford(0);
+		if( ok1 == neg ) cerr << "(random test #" << t << ") bellmanford is wrong about negative cycles" << endl;
+		check_result(G, 0, ok1, F[0], "bellmanford", t);
+		bool ok2 = G.spfa(0);
+		if( ok2 == neg ) cerr << "(random test #" << t << ") spfa is wrong about negative cycles" << endl;
+		check_result(G, 0, ok2, F[0], "spfa", t);
+		bool ok3 = G.bellmanford_parallel(0, t%5);   // 0 runs on one thread
+		if( ok3 == neg ) cerr << "(random test #" << t << ") bellmanford_parallel is wrong about negative cycles" << endl;
+		check_result(G, 0, ok3, F[0], "bellmanford_parallel", t);
+	}
+}
+
+void test_spfa_large_weights() {
+	cerr << "test spfa with large distances" << endl;
+	const size_t N = 100000;
+	const T w = 1000000000000000LL;
+	bellmanford_graph G(N);
+	FOR(v,1,N) G.add_edge(0, v, w + (T)(N-v));
+	FOR(v,1,N-1) G.add_edge(v, v+1, 1);
+	if( !G.spfa(0) ) cerr << "spfa reported a negative cycle" << endl;
+	FOR(v,1,N) if( G.D[v] != w + (T)(N-v) ) {
+		cerr << "spfa got a wrong distance to " << v << endl;   break;
+	}
+}
+
+void test_bellmanford_csr() {
+	cerr << "test bellmanford on a csr_graph" << endl;
+	vector<pair<size_t,size_t>> edges = {{0,1}, {0,2}, {1,3}, {2,3}, {3,4}, {2,1}};
+	VT w = {7, 5, 2, 6, -3, 1};
+	bellmanford_graph G(5);
+	FOR(i,0,edges.size()) G.add_edge(edges[i].first, edges[i].second, w[i]);
+	csr_graph<T> C(5, edges, w);
+	bellmanford_graph_t<csr_rows<size_t>, csr_rows<T>> H(C.adj(), C.weights());
+	if( G.bellmanford(0) != H.bellmanford(0) || G.D != H.D || G.P != H.P ) {
+		cerr << "bellmanford on csr_graph differs from bellmanford_graph" << endl;
+	}
+}
+
 void test_bellmanford_speed() {
 	const size_t N = 700;
 	bellmanford_graph G(N);
@@ -118,14 +331,62 @@ void test_bellmanford_speed() {
 	FOR(j,0,N)
 		if( i != j )
 			G.add_edge(i,j, 1);
-	cerr << "Start speed test..." << endl;
+	cerr << "Start speed test on a complete graph with " << N << " nodes..." << endl;
+	auto start = chrono::steady_clock::now();
+	G.bellmanford(0);
+	cerr << "bellmanford: " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+	start = chrono::steady_clock::now();
+	G.spfa(0);
+	cerr << "spfa: " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+	const size_t M = 1000000;
+	bellmanford_graph H(M);
+	VT pot(M);   // w + pot[s] - pot[t] >= 0, so negative edges but no negative cycles
+	FOR(i,0,M) pot[i] = rand()%5000;
+	FOR(i,0,M) FOR(d,1,4) { size_t j = (i*d + d*d) % M; H.add_edge(i, j, rand()%1000 + pot[j] - pot[i]); }
+	FOR(i,0,M) H.add_edge(i, (i+1) % M, 1000 + pot[(i+1) % M] - pot[i]);
+	cerr << "Start speed test on a random graph with " << M << " nodes, " << 4*M << " edges..." << endl;
+	start = chrono::steady_clock::now();
+	bool ok1 = H.bellmanford(0);
+	cerr << "bellmanford: " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+	start = chrono::steady_clock::now();
+	bool ok2 = H.spfa(0);
+	cerr << "spfa: " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+	if( !ok1 || !ok2 ) cerr << "bellmanford or spfa found a negative cycle" << endl;
+	VT D = H.D;
+	for( size_t th = 1; th <= thread::hardware_concurrency(); th *= 2 ) {
+		start = chrono::steady_clock::now();
+		bool ok3 = H.bellmanford_parallel(0, th);
+		cerr << "bellmanford_parallel, " << th << " threads: " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+		if( !ok3 || H.D != D ) cerr << "bellmanford_parallel got different distances" << endl;
+	}
+}
+
+// a long path needs N rounds, each touching one node
+void test_bellmanford_path() {
+	const size_t N = 20000;
+	bellmanford_graph G(N);
+	FOR(v,0,N-1) G.add_edge(v, v+1, (T)(v%7) - 2);
+	cerr << "Start speed test on a path with " << N << " nodes..." << endl;
+	auto start = chrono::steady_clock::now();
 	G.bellmanford(0);
-	cerr << "End speed test." << endl;
+	cerr << "bellmanford: " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+	VT D = G.D;
+	FOR(th,1,5) {
+		start = chrono::steady_clock::now();
+		bool ok = G.bellmanford_parallel(0, th);
+		cerr << "bellmanford_parallel, " << th << " threads: " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+		if( !ok || G.D != D ) cerr << "bellmanford_parallel got different distances on the path" << endl;
+	}
 }
 
 int main() {
 	test_bellmanford_correct();
+	test_bellmanford_random();
+	test_spfa_large_weights();
+	test_bellmanford_csr();
+	test_bellmanford_path();
 	test_bellmanford_speed();
 	return 0;
 }
-
+#endif // BUILD_TEST_BELLMANFORD
+#endif // BELLMANFORD_CC
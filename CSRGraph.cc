@@ -0,0 +1,95 @@
+#ifndef CSRGRAPH_CC
+#define CSRGRAPH_CC
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+// BEGIN
+// An immutable graph in compressed sparse row form: the out-edges of v are
+// to[off[v] .. off[v+1]-1], with weights wt[...] (wt is empty if unweighted).
+// Two heap blocks in total, however many edges, and rows are contiguous.
+// adj() and weights() are views that index like a vector<vector<...>>, so
+// the graph algorithms in this library can run on them directly.
+
+// rows off[v]..off[v+1]-1 of data; the underlying arrays must outlive the view
+template<class X> struct csr_rows {
+    struct row {
+        const X *b, *e;
+        size_t size() const { return e - b; }
+        const X& operator[](size_t i) const { return b[i]; }
+        const X* begin() const { return b; }
+        const X* end() const { return e; }
+    };
+    const size_t *off; const X *data; size_t n;
+    row operator[](size_t v) const { row r = { data + off[v], data + off[v+1] }; return r; }
+    size_t size() const { return n; }
+};
+
+template<class W = long long> struct csr_graph {
+    size_t N;
+    vector<size_t> off, to;
+    vector<W> wt;
+    // Builds the graph from edges (s, t) with weights w (may be empty),
+    // keeping the input order within each row. If undirected, every edge is
+    // also added as (t, s). Counting sort by source, O(N + E).
+    csr_graph(size_t N, const vector<pair<size_t,size_t>> &edges,
+              const vector<W> &w = vector<W>(), bool undirected = false) : N(N), off(N+1, 0) {
+        size_t E = edges.size() * (undirected ? 2 : 1);
+        for (size_t i = 0; i < edges.size(); ++i) {
+            ++off[edges[i].first + 1];
+            if (undirected) ++off[edges[i].second + 1];
+        }
+        for (size_t v = 0; v < N; ++v) off[v+1] += off[v];
+        vector<size_t> pos(off.begin(), off.end() - 1);
+        to.resize(E);
+        if (!w.empty()) wt.resize(E);
+        for (size_t i = 0; i < edges.size(); ++i) {
+            size_t s = edges[i].first, t = edges[i].second;
+            if (!w.empty()) { wt[pos[s]] = w[i]; if (undirected) wt[pos[t]] = w[i]; }
+            to[pos[s]++] = t;
+            if (undirected) to[pos[t]++] = s;
+        }
+    }
+    // the same graph with every edge reversed
+    csr_graph reversed() const {
+        vector<pair<size_t,size_t>> edges(to.size());
+        for (size_t v = 0; v < N; ++v)
+            for (size_t i = off[v]; i < off[v+1]; ++i)
+                edges[i] = make_pair(to[i], v);
+        return csr_graph(N, edges, wt);
+    }
+    csr_rows<size_t> adj() const { csr_rows<size_t> r = { &off[0], to.data(), N }; return r; }
+    csr_rows<W> weights() const { csr_rows<W> r = { &off[0], wt.data(), N }; return r; }
+};
+
+// END
+
+#ifdef BUILD_TEST_CSR
+#include <iostream>
+
+int main() {
+    cerr << "test csr_graph" << endl;
+    vector<pair<size_t,size_t>> edges = {{0,1}, {2,0}, {0,2}, {1,2}, {3,3}};
+    vector<long long> w = {10, 20, 30, 40, 50};
+    csr_graph<> G(5, edges, w);
+    csr_rows<size_t> A = G.adj();
+    csr_rows<long long> W = G.weights();
+    if (A.size() != 5 || A[0].size() != 2 || A[4].size() != 0) {
+        cerr << "csr_graph has rows of the wrong size" << endl;
+    }
+    if (A[0][0] != 1 || A[0][1] != 2 || W[0][0] != 10 || W[0][1] != 30 || A[3][0] != 3) {
+        cerr << "csr_graph has the wrong edges" << endl;
+    }
+    csr_graph<> R = G.reversed();
+    if (R.adj()[2].size() != 2 || R.adj()[2][0] != 0 || R.weights()[2][1] != 40) {
+        cerr << "reversed csr_graph has the wrong edges" << endl;
+    }
+    csr_graph<> U(3, vector<pair<size_t,size_t>>(1, make_pair(0, 2)), vector<long long>(), true);
+    if (U.adj()[0].size() != 1 || U.adj()[2][0] != 0 || !U.wt.empty()) {
+        cerr << "undirected csr_graph has the wrong edges" << endl;
+    }
+    return 0;
+}
+#endif // BUILD_TEST_CSR
+#endif // CSRGRAPH_CC
@@ -0,0 +1,175 @@
+#ifndef DIJKSTRA_CC
+#define DIJKSTRA_CC
+#include <vector>
+#include <queue>
+#include <limits>
+#include <functional>
+#include "CSRGraph.cc"
+using namespace std;
+// BEGIN
+// Dijkstra's algorithm, for non-negative edge weights only.
+// dijkstra(A, W, S, D, P) sets D and P like bellmanford_graph::bellmanford:
+// D[v] is the shortest distance from S to v (numeric_limits<T>::max() if v
+// is unreachable) and P[v] the parent of v in a shortest-path tree (N if
+// none). A, W are the adjacency and weight lists, so it runs on the members
+// of a bellmanford_graph, on vector<vector<...>>s or on the adj() and
+// weights() views of a csr_graph<T> (see CSRGraph.cc).
+// The heap holds (distance, node) pairs; instead of decrease-key, a node is
+// pushed again when its distance drops and stale entries are skipped when
+// popped. O(E log E).
+// dijkstra_radix does the same with a radix heap, which uses that popped
+// keys never decrease: keys live in bucket i if they first differ from the
+// last popped key in bit i-1 (bucket 0 if equal). O(E + N log C) for
+// largest distance C, and usually faster on integer weights.
+#define FOR(v,l,u) for( size_t v = l; v < u; ++v )
+typedef signed long long int T;
+typedef vector<T>       VT;
+typedef vector<VT>     VVT;
+typedef vector<size_t>  VI;
+typedef vector<VI>     VVI;
+typedef pair<T,size_t>  TI;
+
+template<class Adj, class WAdj>
+void dijkstra( const Adj &A, const WAdj &W, size_t S, VT &D, VI &P ) {
+	size_t N = A.size();
+	D = VT(N, numeric_limits<T>::max()); D[S] = 0; P = VI(N,N);
+	priority_queue<TI, vector<TI>, greater<TI> > Q;   Q.push(TI(0, S));
+	while( !Q.empty() ) {
+		T d = Q.top().first;   size_t s = Q.top().second;   Q.pop();
+		if( d > D[s] ) continue;
+		FOR(i,0,A[s].size()) {
+			size_t t = A[s][i];
+			if( D[t] <= d + W[s][i] ) continue;
+			D[t] = d + W[s][i];   P[t] = s;   Q.push(TI(D[t], t));
+		}
+	}
+}
+
+struct radix_heap {
+	typedef unsigned long long K;
+	vector<pair<K,size_t> > b[65];
+	K last;   size_t n;
+	radix_heap() : last(0), n(0) {}
+	static int bucket( K x, K y ) { return x == y ? 0 : 64 - __builtin_clzll(x ^ y); }
+	bool empty() const { return n == 0; }
+	void push( K k, size_t v ) { b[bucket(k, last)].push_back(make_pair(k, v));   ++n; }
+	// the entry with the least key; requires pushed keys >= the last popped
+	pair<K,size_t> pop() {
+		if( b[0].empty() ) {
+			int i = 1;
+			while( b[i].empty() ) ++i;
+			last = b[i][0].first;
+			FOR(j,1,b[i].size()) last = min(last, b[i][j].first);
+			FOR(j,0,b[i].size()) b[bucket(b[i][j].first, last)].push_back(b[i][j]);
+			b[i].clear();
+		}
+		pair<K,size_t> r = b[0].back();   b[0].pop_back();   --n;
+		return r;
+	}
+};
+
+template<class Adj, class WAdj>
+void dijkstra_radix( const Adj &A, const WAdj &W, size_t S, VT &D, VI &P ) {
+	size_t N = A.size();
+	D = VT(N, numeric_limits<T>::max()); D[S] = 0; P = VI(N,N);
+	radix_heap Q;   Q.push(0, S);
+	while( !Q.empty() ) {
+		pair<radix_heap::K,size_t> e = Q.pop();
+		T d = e.first;   size_t s = e.second;
+		if( d > D[s] ) continue;
+		FOR(i,0,A[s].size()) {
+			size_t t = A[s][i];
+			if( D[t] <= d + W[s][i] ) continue;
+			D[t] = d + W[s][i];   P[t] = s;   Q.push(D[t], t);
+		}
+	}
+}
+// END
+
+#ifdef BUILD_TEST_DIJKSTRA
+#include <iostream>
+#include <chrono>
+#include "BellmanFord.cc"
+
+// D must be the distances; checks that P is a shortest-path tree for them
+bool valid_parents( const bellmanford_graph &G, size_t S, const VT &D, const VI &P ) {
+	FOR(v,0,G.N) {
+		if( v == S || D[v] == INFINITY ) { if( P[v] != G.N ) return false; continue; }
+		bool ok = false;
+		FOR(i,0,G.A[P[v]].size()) if( G.A[P[v]][i] == v && D[P[v]] + G.W[P[v]][i] == D[v] ) ok = true;
+		if( !ok ) return false;
+	}
+	return true;
+}
+
+void test_dijkstra_random() {
+	cerr << "test dijkstra against bellmanford" << endl;
+	FOR(t,0,500) {
+		size_t n = 1 + rand()%30, m = rand()%(4*n), S = rand()%n;
+		bellmanford_graph G(n);
+		FOR(i,0,m) G.add_edge(rand()%n, rand()%n, rand()%(t%2 ? 3 : 1000));
+		G.bellmanford(S);
+		VT D;   VI P;
+		dijkstra(G.A, G.W, S, D, P);
+		if( D != G.D || !valid_parents(G, S, D, P) ) {
+			cerr << "(random test #" << t << ") dijkstra is wrong" << endl;
+		}
+		dijkstra_radix(G.A, G.W, S, D, P);
+		if( D != G.D || !valid_parents(G, S, D, P) ) {
+			cerr << "(random test #" << t << ") dijkstra_radix is wrong" << endl;
+		}
+	}
+}
+
+void test_dijkstra_csr() {
+	cerr << "test dijkstra on a csr_graph" << endl;
+	vector<pair<size_t,size_t>> edges = {{0,1}, {0,2}, {1,3}, {2,3}, {3,4}, {2,1}};
+	VT w = {7, 5, 2, 6, 3, 1};
+	bellmanford_graph G(5);
+	FOR(i,0,edges.size()) G.add_edge(edges[i].first, edges[i].second, w[i]);
+	G.bellmanford(0);
+	csr_graph<T> C(5, edges, w);
+	VT D;   VI P;
+	dijkstra(C.adj(), C.weights(), 0, D, P);
+	if( D != G.D || P != G.P ) cerr << "dijkstra on csr_graph differs from bellmanford" << endl;
+	dijkstra_radix(C.adj(), C.weights(), 0, D, P);
+	if( D != G.D || P != G.P ) cerr << "dijkstra_radix on csr_graph differs from bellmanford" << endl;
+}
+
+// a side x side grid with random weights in both directions, roughly
+// the shape and degree of a road network
+void test_dijkstra_speed() {
+	const size_t side = 1000, N = side*side;
+	vector<pair<size_t,size_t>> edges;   VT w;
+	FOR(i,0,side) FOR(j,0,side) {
+		size_t v = i*side + j;
+		if( j+1 < side ) { edges.push_back(make_pair(v, v+1));    w.push_back(1 + rand()%1000); }
+		if( i+1 < side ) { edges.push_back(make_pair(v, v+side)); w.push_back(1 + rand()%1000); }
+	}
+	csr_graph<T> C(N, edges, w, true);
+	bellmanford_graph_t<csr_rows<size_t>, csr_rows<T>> G(C.adj(), C.weights());
+	cerr << "Start speed test on a grid with " << N << " nodes, " << C.to.size() << " edges..." << endl;
+	VT D;   VI P;
+	auto start = chrono::steady_clock::now();
+	dijkstra(G.A, G.W, 0, D, P);
+	cerr << "dijkstra: " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+	start = chrono::steady_clock::now();
+	dijkstra_radix(G.A, G.W, 0, D, P);
+	cerr << "dijkstra_radix: " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+	start = chrono::steady_clock::now();
+	G.spfa(0);
+	cerr << "spfa: " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+	start = chrono::steady_clock::now();
+	G.bellmanford(0);
+	cerr << "bellmanford: " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+	if( D != G.D ) cerr << "dijkstra and bellmanford disagree" << endl;
+}
+
+int main() {
+	test_dijkstra_random();
+	test_dijkstra_csr();
+	test_dijkstra_speed();
+	return 0;
+}
+#endif // BUILD_TEST_DIJKSTRA
+#endif // DIJKSTRA_CC
@@ -1,5 +1,9 @@
 #include <vector>
 #include <string>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 using namespace std;
 // BEGIN
 // An implemention of Knuth-Morris-Pratt substring-finding.
@@ -35,9 +39,82 @@ size_t KMP( string &s, string &q ) {
 	}
 	return s.size();
 }
+// A reusable searcher for q, caching its table. With SSE2, 16 positions at a
+// time are filtered on q's first and last characters and only candidates are
+// compared in full; if that wastes too much work (eg. periodic text) it falls
+// back to KMP, so the worst case stays O(|q|+n).
+struct searcher {
+	string q; VI T;
+	searcher( const string &q ) : q(q) { KMP_table(this->q, T); }
+	// calls report(i) for each occurrence q == s[i..i+|q|-1] in increasing
+	// order of i, until report returns true.
+	template<class F> void scan( const char *s, size_t n, F report ) const {
+		size_t k = q.size(), m = 0;
+		if( k == 0 || k > n ) return;
+#ifdef __SSE2__
+		__m128i f = _mm_set1_epi8(q[0]), l = _mm_set1_epi8(q[k-1]);
+		size_t work = 0;
+		for( ; m+k+15 <= n; m += 16 ) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(s+m));
+			__m128i b = _mm_loadu_si128((const __m128i*)(s+m+k-1));
+			unsigned mask = _mm_movemask_epi8(
+				_mm_and_si128(_mm_cmpeq_epi8(a,f), _mm_cmpeq_epi8(b,l)) );
+			while( mask ) {
+				size_t i = m + __builtin_ctz(mask);   mask &= mask-1;
+				if( memcmp(s+i, q.data(), k) == 0 && report(i) ) return;
+				if( (work += k) > 2*m + 1024 ) return kmp_scan(s, n, i+1, report);
+			}
+		}
+#endif
+		kmp_scan(s, n, m, report);
+	}
+	// plain KMP over s[m..n-1]
+	template<class F> void kmp_scan( const char *s, size_t n, size_t m, F report ) const {
+		size_t z = 0, k = q.size();
+		while( m+z < n ) {
+			if( q[z] == s[m+z] ) {
+				if( ++z < k ) continue;
+				if( report(m) ) return;
+				m += z - T[z];   z = T[z];
+			}
+			else if( z > 0 ) { m += z - T[z];   z = T[z]; }
+			else             { m += 1; }
+		}
+	}
+	// first occurrence of q in s, or n if there is none
+	size_t find( const char *s, size_t n ) const {
+		size_t r = n;
+		scan(s, n, [&](size_t i) { r = i; return true; });
+		return r;
+	}
+	VI find_all( const char *s, size_t n ) const {
+		VI r;
+		scan(s, n, [&](size_t i) { r.push_back(i); return false; });
+		return r;
+	}
+};
+// KMP over a stream: text is fed in chunks of any size, and the partial match
+// length z is kept between calls, so memory use is O(|q|). report(i) is called
+// with the absolute offset i of each occurrence.
+struct kmp_stream {
+	string q; VI T;
+	size_t z = 0, pos = 0;   // pos is the number of characters fed so far
+	kmp_stream( const string &q ) : q(q) { KMP_table(this->q, T); }
+	template<class F> void feed( const char *s, size_t n, F report ) {
+		const size_t k = q.size();
+		if( k == 0 ) return;
+		for( size_t i = 0; i < n; ++i, ++pos ) {
+			while( z > 0 && q[z] != s[i] ) z = T[z];
+			if( q[z] == s[i] ) ++z;
+			if( z == k ) { report(pos+1-k); z = T[z]; }
+		}
+	}
+};
 // END
 
 #include <iostream>
+#include <cstdlib>
+#include <algorithm>
 
 void test_KMP_correct() {
 	string a = (string)"The example above illustrates the general technique for assembling "+
@@ -63,8 +140,66 @@ void test_KMP_correct() {
 	}
 }
 
+VI naive_find_all( const string &s, const string &q ) {
+	VI r;
+	for( size_t i = 0; i+q.size() <= s.size(); ++i )
+		if( s.compare(i, q.size(), q) == 0 ) r.push_back(i);
+	return r;
+}
+
+void test_searcher_correct() {
+	for( size_t t = 0; t < 2000; ++t ) {
+		size_t alpha = 1 + t%4;
+		string s(rand()%300, '?'), q(1 + rand()%8, '?');
+		for( size_t i = 0; i < s.size(); ++i ) s[i] = 'a' + rand()%alpha;
+		for( size_t i = 0; i < q.size(); ++i ) q[i] = 'a' + rand()%alpha;
+		searcher S(q);
+		VI exp = naive_find_all(s, q);
+		if( S.find_all(s.data(), s.size()) != exp ) {
+			cerr << "searcher::find_all failed for " << q << " in " << s << endl;
+		}
+		if( S.find(s.data(), s.size()) != (exp.empty() ? s.size() : exp[0]) ) {
+			cerr << "searcher::find failed for " << q << " in " << s << endl;
+		}
+	}
+}
+
+void test_kmp_stream_correct() {
+	for( size_t t = 0; t < 2000; ++t ) {
+		size_t alpha = 1 + t%4;
+		string s(rand()%300, '?'), q(1 + rand()%8, '?');
+		for( size_t i = 0; i < s.size(); ++i ) s[i] = 'a' + rand()%alpha;
+		for( size_t i = 0; i < q.size(); ++i ) q[i] = 'a' + rand()%alpha;
+		kmp_stream K(q);   VI r;
+		for( size_t i = 0, len; i < s.size(); i += len ) {
+			len = min(s.size()-i, (size_t)rand()%20);
+			K.feed(s.data()+i, len, [&](size_t p) { r.push_back(p); });
+		}
+		if( r != naive_find_all(s, q) ) {
+			cerr << "kmp_stream failed for " << q << " in " << s << endl;
+		}
+	}
+}
+
+void test_searcher_speed() {
+	string s(100000000, '?');
+	for( size_t i = 0; i < s.size(); ++i ) s[i] = 'a' + rand()%26;
+	string q = s.substr(s.size()-20);
+	cerr << "Start KMP speed test..." << endl;
+	KMP(s, q);
+	cerr << "End KMP speed test. Start searcher speed test..." << endl;
+	searcher(q).find(s.data(), s.size());
+	cerr << "End searcher speed test. Start adversarial searcher speed test..." << endl;
+	s = string(s.size(), 'a');   q = string(1000, 'a') + 'b';
+	searcher(q).find(s.data(), s.size());
+	cerr << "End speed test." << endl;
+}
+
 int main() {
 	test_KMP_correct();
+	test_searcher_correct();
+	test_kmp_stream_correct();
+	test_searcher_speed();
 	return 0;
 }
 
@@ -2,6 +2,7 @@
 #define KRUSKAL_CC
 #include <algorithm>
 #include "UnionFind.cc"
+#include "CSRGraph.cc"
 
 using namespace std;
 
@@ -37,11 +38,34 @@ double kruskal(vdii &edges, size_t n) {
     return cost;
 }
 
+// the same on an undirected csr_graph (see CSRGraph.cc), which stores each
+// edge in both directions; only the copy with s < t is used. An unweighted
+// graph (wt empty) counts every edge as weight 1.
+template<class W> double kruskal(const csr_graph<W> &G) {
+    vdii edges;
+    for (size_t s = 0; s < G.N; ++s)
+        for (size_t i = G.off[s]; i < G.off[s+1]; ++i)
+            if (s < G.to[i]) edges.push_back(dii(G.wt.empty() ? 1 : G.wt[i], ii(s, G.to[i])));
+    return kruskal(edges, G.N);
+}
+
 // END
 
 #ifdef BUILD_TEST_KRUSKAL
+#include <iostream>
 int main() {
-    //TODO: implement tests
+    vector<pair<size_t,size_t>> e = {{0,1}, {1,2}, {0,2}, {2,3}, {1,3}};
+    vector<double> w = {1, 2, 4, 3, 5};
+    vdii edges;
+    for (size_t i = 0; i < e.size(); ++i) edges.push_back(dii(w[i], e[i]));
+    csr_graph<double> G(4, e, w, true);
+    if (kruskal(edges, 4) != 6 || kruskal(G) != 6) {
+        cerr << "kruskal computed the wrong MST cost" << endl;
+    }
+    csr_graph<double> U(5, e, vector<double>(), true);
+    if (kruskal(U) != 3) {
+        cerr << "kruskal computed the wrong MST cost on an unweighted graph" << endl;
+    }
     //TODO: make Kruskal return edges used
     //successfully tested on UVa Online Judge Anti Brute Force Lock
 }
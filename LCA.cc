@@ -2,6 +2,7 @@
 #include <vector>
 #include <stack>
 #include <algorithm>
+#include "CSRGraph.cc"
 
 using namespace std;
 
@@ -41,6 +42,29 @@ void get_dist(VVII &tree, VI &dist, VI &L) {
     }
 }
 
+// the same, for a tree given as a csr_graph<int> of parent->child edges
+// (see CSRGraph.cc), where an unweighted tree (wt empty) has weight 1 on
+// every edge; also sets P[v][0] to the parent of v
+void get_dist(const csr_graph<int> &tree, VI &dist, VI &L, VVI &P) {
+    csr_rows<size_t> A = tree.adj();
+    csr_rows<int> W = tree.weights();
+    bool weighted = !tree.wt.empty();
+    stack<int> s;
+    s.push(0);
+    dist[0] = 0;
+    L[0] = 0;
+    while (!s.empty()) {
+        int cur = s.top(); s.pop();
+        for (size_t i = 0; i < A[cur].size(); ++i) {
+            int v = A[cur][i];
+            dist[v] = dist[cur] + (weighted ? W[cur][i] : 1);
+            L[v] = L[cur]+1;
+            P[v][0] = cur;
+            s.push(v);
+        }
+    }
+}
+
 // uses dynamic programming to preprocess the P table
 void preprocess(VVI &P, int N) {
     for (int j = 1; (1 << j) < N; ++j) {
@@ -118,8 +142,29 @@ void test_LCA_correct() {
     test_case(0, a36);
 }
 
+void test_LCA_csr() {
+    size_t N = 8;
+    vector<pair<size_t,size_t>> edges = {{0,1}, {1,2}, {1,3}, {1,4}, {0,5}, {5,6}, {6,7}};
+    vector<int> w = {2, 6, 13, 2, 4, 7, 20};
+    csr_graph<int> tree(N, edges, w);
+    VVI P(N, VI(log2(N), -1));
+    VI dist(N), L(N);
+    get_dist(tree, dist, L, P);
+    preprocess(P, N);
+    test_case(0, LCA(1, 5, P, L, N));
+    test_case(1, LCA(2, 4, P, L, N));
+    test_case(5, LCA(5, 7, P, L, N));
+    test_case(0, LCA(3, 6, P, L, N));
+    test_case(31, dist[7]);
+    csr_graph<int> unweighted(N, edges);
+    get_dist(unweighted, dist, L, P);
+    test_case(3, dist[7]);
+    test_case(2, dist[4]);
+}
+
 int main() {
     test_LCA_correct();
+    test_LCA_csr();
 
     return 0;
 }
@@ -0,0 +1,208 @@
+#ifndef NTT_CC
+#define NTT_CC
+#include <cstdint>
+#include <algorithm>
+#include <cassert>
+#include "Algebra.cc"
+
+// BEGIN
+// Number-theoretic transform: the FFT over Z/pZ, for primes p = c*2^k + 1
+// with p < 2^30 and n <= 2^k (asserted). Convolutions come out exact
+// (mod p). It has the same plan interface as fft_plan in FFT.cc; values
+// must lie in [0, p).
+// Products use Montgomery reduction with R = 2^32. The twiddles are kept
+// multiplied by R, so reducing a*(wR) gives a*w directly in normal form.
+typedef vector<uint32_t> VU;
+
+struct ntt_plan {
+    size_t n;
+    uint32_t p, pinv;       // pinv = -1/p mod 2^32
+    vector<size_t> rev;
+    VU roots[2];            // roots[invert][len+j] = w^(+-j) R mod p, w of order 2 len
+    uint32_t ninv;          // R/n mod p
+    ntt_plan(size_t n, T p, T g = 3) : n(n), p(p), rev(n) {
+        assert((p-1) % n == 0);   // otherwise there is no root of unity of order n
+        uint32_t inv = p;
+        for (int i = 0; i < 4; ++i) inv *= 2 - p*inv;
+        pinv = -inv;
+        for (size_t i = 1; i < n; ++i)
+            rev[i] = (rev[i>>1] >> 1) | (i & 1 ? n >> 1 : 0);
+        for (int iv = 0; iv < 2; ++iv) {
+            roots[iv].resize(max<size_t>(n, 2));
+            for (size_t len = 1; len < n; len <<= 1) {
+                T w = pow_mod(g, (p-1) / (2*len), p), x = 1;
+                if (iv) w = pow_mod(w, p-2, p);
+                for (size_t j = 0; j < len; ++j, x = x*w % p)
+                    roots[iv][len+j] = ((uint64_t)x << 32) % p;
+            }
+        }
+        ninv = ((uint64_t)pow_mod(n, p-2, p) << 32) % p;
+    }
+    // a*b/R mod p, for a*b < p*2^32
+    uint32_t mul(uint64_t ab) const {
+        uint32_t m = (uint32_t)ab * pinv;
+        uint32_t t = (ab + (uint64_t)m*p) >> 32;
+        return t >= p ? t - p : t;
+    }
+    void operator()(VU &a, bool invert) const {
+        for (size_t i = 1; i < n; ++i)
+            if (i < rev[i]) swap(a[i], a[rev[i]]);
+        const VU &w = roots[invert];
+        for (size_t len = 1; len < n; len <<= 1) {
+            for (size_t i = 0; i < n; i += 2*len) {
+                for (size_t j = 0; j < len; ++j) {
+                    uint32_t u = a[i+j], v = mul((uint64_t)a[i+j+len] * w[len+j]);
+                    a[i+j] = u+v >= p ? u+v-p : u+v;
+                    a[i+j+len] = u >= v ? u-v : u+p-v;
+                }
+            }
+        }
+        if (invert)
+            for (size_t i = 0; i < n; ++i)
+                a[i] = mul((uint64_t)a[i] * ninv);
+    }
+};
+
+// Linear convolution of a and b mod p, for an NTT-friendly prime p < 2^30
+// (998244353 = 119*2^23+1, 167772161 = 5*2^25+1, 469762049 = 7*2^26+1,
+// all with primitive root 3). The output length |a|+|b|-1 must be at most
+// 2^k, eg. 2^23 for 998244353.
+VT convolve_mod(const VT &a, const VT &b, T p, T g = 3) {
+    if (a.empty() || b.empty()) return VT();
+    size_t n = 1, m = a.size() + b.size() - 1;
+    while (n < m) n <<= 1;
+    ntt_plan plan(n, p, g);
+    VU A(n), B(n);
+    for (size_t i = 0; i < a.size(); ++i) A[i] = (a[i] % p + p) % p;
+    for (size_t i = 0; i < b.size(); ++i) B[i] = (b[i] % p + p) % p;
+    plan(A, false); plan(B, false);
+    for (size_t i = 0; i < n; ++i) A[i] = (uint64_t)A[i] * B[i] % p;
+    plan(A, true);
+    VT c(m);
+    for (size_t i = 0; i < m; ++i) c[i] = A[i];
+    return c;
+}
+
+// (x + y) mod m for x, y in [0, m), m < 2^63
+T add_mod(T x, T y, T m) {
+    unsigned long long z = (unsigned long long)x + y;
+    return (T)(z >= (unsigned long long)m ? z - m : z);
+}
+
+// Exact convolution of a and b (entries in [0, 2^63)) reduced mod m, by
+// convolving mod the three primes above and combining the results with
+// Garner's algorithm. Exact as long as the true coefficients are below the
+// primes' product P (about 2^86), ie. min(|a|,|b|) * max(a) * max(b) < P,
+// and the output has at most 2^23 terms (the limit of 998244353).
+VT convolve_crt(const VT &a, const VT &b, T m) {
+    const T p1 = 998244353, p2 = 167772161, p3 = 469762049;
+    VT c1 = convolve_mod(a, b, p1), c2 = convolve_mod(a, b, p2), c3 = convolve_mod(a, b, p3);
+    const T i12 = modinv(p1 % p2, p2), i123 = modinv(p1 * p2 % p3, p3), p12 = p1 * p2 % m;
+    for (size_t i = 0; i < c1.size(); ++i) {
+        T x12 = c1[i] + p1 * (((c2[i] - c1[i]) % p2 + p2) * i12 % p2);   // < p1 p2
+        T t = ((c3[i] - x12 % p3) % p3 + p3) % p3 * i123 % p3;
+        c1[i] = add_mod(x12 % m, mult_mod(p12, t, m), m);
+    }
+    return c1;
+}
+
+// Linear convolution mod any m < 2^63. Small moduli (min(|a|,|b|) (m-1)^2
+// < P) take one convolve_crt. Otherwise entries are split into halves of s
+// bits, x = hi 2^s + lo, and the four products are recombined mod m, which
+// is exact while min(|a|,|b|) 4^s < P: for 63-bit m, up to 2^22 terms.
+// The output may have at most 2^23 terms, as in convolve_crt. Inputs past
+// either limit fail an assert instead of returning wrong results.
+VT convolve_mod_any(const VT &a, const VT &b, T m) {
+    const long double P = 998244353.0L * 167772161.0L * 469762049.0L;
+    VT A(a), B(b);
+    for (size_t i = 0; i < A.size(); ++i) if ((A[i] %= m) < 0) A[i] += m;
+    for (size_t i = 0; i < B.size(); ++i) if ((B[i] %= m) < 0) B[i] += m;
+    const long double k = min(A.size(), B.size());
+    if (k * (m-1) * (m-1) < P) return convolve_crt(A, B, m);
+    int s = (64 - __builtin_clzll(m-1) + 1) / 2;
+    assert(k * (long double)(1ULL << s) * (long double)(1ULL << s) < P);
+    const T mask = (1LL << s) - 1;
+    VT Alo(A.size()), Ahi(A.size()), Blo(B.size()), Bhi(B.size());
+    for (size_t i = 0; i < A.size(); ++i) { Alo[i] = A[i] & mask; Ahi[i] = A[i] >> s; }
+    for (size_t i = 0; i < B.size(); ++i) { Blo[i] = B[i] & mask; Bhi[i] = B[i] >> s; }
+    VT ll = convolve_crt(Alo, Blo, m), lh = convolve_crt(Alo, Bhi, m);
+    VT hl = convolve_crt(Ahi, Blo, m), hh = convolve_crt(Ahi, Bhi, m);
+    const T w = (1LL << s) % m, w2 = mult_mod(w, w, m);
+    for (size_t i = 0; i < ll.size(); ++i) {
+        T mid = add_mod(lh[i], hl[i], m);
+        ll[i] = add_mod(add_mod(ll[i], mult_mod(mid, w, m), m), mult_mod(hh[i], w2, m), m);
+    }
+    return ll;
+}
+// END
+
+#ifdef BUILD_TEST_NTT
+#include <chrono>
+
+VT naive_convolve_mod(const VT &a, const VT &b, T m) {
+    VT c(a.size() + b.size() - 1);
+    FOR(i,0,a.size()) FOR(j,0,b.size()) c[i+j] = add_mod(c[i+j], mult_mod(a[i], b[j], m), m);
+    return c;
+}
+
+void test_convolve_mod() {
+    cerr << "test convolve_mod" << endl;
+    const T primes[] = {998244353, 167772161, 469762049};
+    FOR(t,0,300) {
+        T p = primes[t%3];
+        VT a(1 + rand()%100), b(1 + rand()%100);
+        FOR(i,0,a.size()) a[i] = rand() % p;
+        FOR(i,0,b.size()) b[i] = rand() % p;
+        if (convolve_mod(a, b, p) != naive_convolve_mod(a, b, p)) {
+            cerr << "convolve_mod mod " << p << " gave a wrong result (test #" << t << ")" << endl;
+        }
+    }
+}
+
+void test_convolve_mod_any() {
+    cerr << "test convolve_mod_any" << endl;
+    const T mods[] = {1000000007, 1000000009, (1LL << 33) + 17, 2,
+                      (1LL << 40) + 15, 9223372036854775783LL, (1LL << 62) + 135, 1};
+    FOR(t,0,400) {
+        T m = mods[t%8];
+        VT a(1 + rand()%100), b(1 + rand()%100);
+        FOR(i,0,a.size()) a[i] = (T)(((unsigned long long)rand() << 42 ^ (unsigned long long)rand() << 21 ^ rand()) % m);
+        FOR(i,0,b.size()) b[i] = (T)(((unsigned long long)rand() << 42 ^ (unsigned long long)rand() << 21 ^ rand()) % m);
+        if (convolve_mod_any(a, b, m) != naive_convolve_mod(a, b, m)) {
+            cerr << "convolve_mod_any mod " << m << " gave a wrong result (test #" << t << ")" << endl;
+        }
+    }
+}
+
+void test_convolve_mod_limit() {
+    cerr << "test convolve_mod at the 2^23 output limit" << endl;
+    VT a(1, 1), b((1 << 23) - 1);   // one more term would fail the assert
+    FOR(i,0,b.size()) b[i] = rand() % 998244353;
+    if (convolve_mod(a, b, 998244353) != b) {
+        cerr << "convolve_mod with 2^23 output terms gave a wrong result" << endl;
+    }
+}
+
+void test_ntt_speed() {
+    const size_t n = 1 << 20;
+    VT a(n), b(n);
+    FOR(i,0,n) { a[i] = rand(); b[i] = rand(); }
+    cerr << "Start speed test, two polynomials with " << n << " terms..." << endl;
+    auto start = chrono::steady_clock::now();
+    convolve_mod(a, b, 998244353);
+    cerr << "convolve_mod: " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+    start = chrono::steady_clock::now();
+    convolve_mod_any(a, b, 1000000007);
+    cerr << "convolve_mod_any: " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s" << endl;
+}
+
+int main() {
+    srand(0);
+    test_convolve_mod();
+    test_convolve_mod_any();
+    test_convolve_mod_limit();
+    test_ntt_speed();
+    return 0;
+}
+#endif // BUILD_TEST_NTT
+#endif // NTT_CC
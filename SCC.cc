@@ -1,77 +1,331 @@
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include "CSRGraph.cc"
+#include "UnionFind.cc"
+#include "ThreadPool.cc"
 using namespace std;
 // BEGIN
-// An implementation of Kosaraju's algorithm for strongly-connected components
+// An implementation of Tarjan's algorithm for strongly-connected components
 // This includes code which constructs a "meta" graph with one node per SCC.
+// Adj is the adjacency type: vector<vector<size_t>> for graph, or the
+// csr_rows views of a csr_graph (see CSRGraph.cc) via graph_t<csr_rows<size_t>>.
 #define FOR(v,l,u) for( size_t v = l; v < u; ++v )
 typedef vector<size_t> VI;
 typedef vector<VI>     VVI;
 typedef vector<bool>   VB;
-struct graph {
+template<class Adj = VVI> struct graph_t {
 	size_t N;
-	VVI    A; // Adjacency lists.
-	VVI    B; // Reversed adjacency lists.
+	Adj    A; // Adjacency lists.
+	Adj    B; // Reversed adjacency lists.
 	VI     scc;    // scc[i] is the component to which i belongs
 	size_t n_sccs; // the number of components
-	graph( size_t n ) : N(n), A(n), B(n), scc(n) {}
+	graph_t( size_t n ) : N(n), A(n), B(n), scc(n) {}
+	graph_t( const Adj &A, const Adj &B ) : N(A.size()), A(A), B(B), scc(N) {}
+	graph_t( const Adj &A ) : N(A.size()), A(A), B(), scc(N) {} // B is not needed for SCCs
 	void add_edge( size_t s, size_t t ) {
 		A[s].push_back(t);
 		B[t].push_back(s);
 	}
-	void dfs_order( size_t rt, VB &Vis, VI &order ) {
-		Vis[rt] = true;
-		FOR(i,0,A[rt].size()) {
-			size_t v = A[rt][i];
-			if( Vis[v] ) continue;
-			dfs_order( v, Vis, order );
+	// Tarjan's algorithm with an explicit stack, so deep graphs (eg. long
+	// paths) cannot overflow the call stack. Components are numbered in
+	// topological order: every edge goes from scc[s] to some scc[t] >= scc[s].
+	// The work arrays are kept between calls.
+	VI idx, low, pos, stk, calls;   VB on_stk;
+	void compute_sccs() {
+		idx.assign(N, N);   low.assign(N, 0);   pos.assign(N, 0);
+		on_stk.assign(N, false);   stk.clear();   calls.clear();
+		stk.reserve(N);   calls.reserve(N);
+		size_t counter = 0;   n_sccs = 0;
+		FOR(r,0,N) {
+			if( idx[r] != N ) continue;
+			idx[r] = low[r] = counter++;   stk.push_back(r);   on_stk[r] = true;
+			calls.push_back(r);
+			while( !calls.empty() ) {
+				size_t v = calls.back();
+				if( pos[v] < A[v].size() ) {
+					size_t w = A[v][pos[v]++];
+					if( idx[w] == N ) {
+						idx[w] = low[w] = counter++;   stk.push_back(w);   on_stk[w] = true;
+						calls.push_back(w);
+					}
+					else if( on_stk[w] ) low[v] = min(low[v], idx[w]);
+					continue;
+				}
+				calls.pop_back();
+				if( !calls.empty() ) low[calls.back()] = min(low[calls.back()], low[v]);
+				if( low[v] != idx[v] ) continue;
+				size_t x;
+				do {   // v is the root of a component; Tarjan finds sinks first
+					x = stk.back();   stk.pop_back();   on_stk[x] = false;
+					scc[x] = n_sccs;
+				} while( x != v );
+				++n_sccs;
+			}
 		}
-		order.push_back(rt);
+		FOR(v,0,N) scc[v] = n_sccs-1 - scc[v];
 	}
-	void dfs_label( size_t rt, VB &Vis, size_t lbl, VI &out ) {
-		Vis[rt] = true;
-		out[rt] = lbl;
-		FOR(i,0,A[rt].size()) {
-			size_t v = A[rt][i];
-			if( Vis[v] ) continue;
-			dfs_label( v, Vis, lbl, out );
+	// Parallel SCCs by forward-backward reachability with trimming (needs B).
+	// Each subproblem is the set of nodes of one color. Nodes with no in- or
+	// out-edges inside their color are trimmed as singleton components, and
+	// so on until none are left (counting live neighbours in din and dout);
+	// then the nodes reachable both ways from a pivot form a component, and
+	// those reachable only forwards, only backwards, or neither become three
+	// new colors. Large subproblems are done one at a time with
+	// level-synchronous parallel BFS; small ones are spread over a
+	// work-stealing pool. Both phases share one thread_pool, and levels with
+	// small frontiers are expanded on the calling thread, so long paths and
+	// cycles cost about as much as in compute_sccs. Finds the same components
+	// as compute_sccs, also numbered in topological order (though not
+	// necessarily the same one).
+	typedef pair<size_t, VI> task;   // (color, nodes that may still have it)
+	typedef vector<atomic<size_t>> VA;
+	void fb_step( VA &col, VA &din, VA &dout, VI &comp, atomic<size_t> &n_cols,
+	              atomic<size_t> &n_comps, task &T, thread_pool *P, vector<task> &out ) {
+		const size_t c = T.first, DONE = (size_t)-1, TRIM = DONE-1, k = P ? P->threads : 1;
+		VI &vs = T.second, frontier;
+		vector<VI> next(k);
+		auto gather = [&]() {
+			frontier.clear();
+			FOR(t,0,k) { frontier.insert(frontier.end(), next[t].begin(), next[t].end());   next[t].clear(); }
+		};
+		auto live = [&]( const Adj &G, size_t v ) {
+			size_t d = 0;
+			FOR(i,0,G[v].size()) d += G[v][i] != v && col[G[v][i]] == c;
+			return d;
+		};
+		// queues v for trimming, unless it already is
+		auto trim = [&]( size_t t, size_t v ) {
+			size_t x = c;
+			if( col[v].compare_exchange_strong(x, TRIM) ) next[t].push_back(v);
+		};
+		split_range(P, vs.size(), [&]( size_t, size_t lo, size_t hi ) {
+			FOR(i,lo,hi) if( col[vs[i]] == c ) { din[vs[i]] = live(B, vs[i]);   dout[vs[i]] = live(A, vs[i]); }
+		});
+		split_range(P, vs.size(), [&]( size_t t, size_t lo, size_t hi ) {
+			FOR(i,lo,hi) if( col[vs[i]] == c && (din[vs[i]] == 0 || dout[vs[i]] == 0) ) trim(t, vs[i]);
+		});
+		for( gather(); !frontier.empty(); gather() ) {
+			split_range(P, frontier.size(), [&]( size_t t, size_t lo, size_t hi ) {
+				FOR(i,lo,hi) {
+					size_t v = frontier[i];
+					comp[v] = n_comps++;   col[v] = DONE;
+					FOR(j,0,A[v].size()) { size_t w = A[v][j]; if( w != v && col[w] == c && --din[w] == 0 ) trim(t, w); }
+					FOR(j,0,B[v].size()) { size_t w = B[v][j]; if( w != v && col[w] == c && --dout[w] == 0 ) trim(t, w); }
+				}
+			});
 		}
-	}
-	void compute_sccs() {
-		VB visited(N,false);   VI order;
-		FOR(v,0,N) if( !visited[v] ) dfs_order(v, visited, order);
-		swap(A,B);
-		visited = VB(N,false); n_sccs = 0;
-		FOR(i,0,N) {
-			size_t v = order[N-1-i];
-			if( !visited[v] ) dfs_label(v, visited, n_sccs++, scc);
-		}
-		swap(A,B);
-	}
-	void compute_scc_graph( graph &H ) {
-		H = graph(n_sccs);
-		VVI cpts(n_sccs);
-		FOR(i,0,N) {
-			cpts[scc[i]].push_back(i);
-		}
-		FOR(i,0,n_sccs) {
-			FOR(j,0,cpts[i].size()) {
-				size_t u = cpts[i][j];
-				FOR(k,0,A[u].size()) {
-					size_t v = A[u][k];
-					size_t vv = scc[v];
-					if (H.B[vv].empty() || H.B[vv].back() != i) {
-						H.add_edge(i,vv);
+		VI left;
+		FOR(i,0,vs.size()) if( col[vs[i]] == c ) left.push_back(vs[i]);
+		if( left.empty() ) return;
+		const size_t p = left[left.size()/2], F = n_cols++, Bw = n_cols++, S = n_cols++;
+		// BFS from p over G, moving nodes from color c1 to d1 or c2 to d2
+		auto bfs = [&]( const Adj &G, size_t c1, size_t d1, size_t c2, size_t d2 ) {
+			for( frontier.assign(1, p); !frontier.empty(); gather() ) {
+				split_range(P, frontier.size(), [&]( size_t t, size_t lo, size_t hi ) {
+					FOR(i,lo,hi) FOR(j,0,G[frontier[i]].size()) {
+						size_t w = G[frontier[i]][j], x = c1, y = c2;
+						if( col[w].compare_exchange_strong(x, d1) || col[w].compare_exchange_strong(y, d2) )
+							next[t].push_back(w);
 					}
+				});
+			}
+		};
+		col[p] = F;   bfs(A, c, F, c, F);
+		col[p] = S;   bfs(B, F, S, c, Bw);
+		const size_t K = n_comps++;
+		task fw(F, VI()), bw(Bw, VI()), rest(c, VI());
+		FOR(i,0,left.size()) {
+			size_t v = left[i], cv = col[v];
+			if( cv == S )       { comp[v] = K; col[v] = DONE; }
+			else if( cv == F )  fw.second.push_back(v);
+			else if( cv == Bw ) bw.second.push_back(v);
+			else                rest.second.push_back(v);
+		}
+		if( !fw.second.empty() )   out.push_back(move(fw));
+		if( !bw.second.empty() )   out.push_back(move(bw));
+		if( !rest.second.empty() ) out.push_back(move(rest));
+	}
+	void compute_sccs_parallel( size_t threads, size_t big = 1 << 16 ) {
+		thread_pool pool(threads);   threads = pool.threads;
+		VA col(N), din(N), dout(N);   VI comp(N);
+		atomic<size_t> n_cols(1), n_comps(0);
+		FOR(v,0,N) col[v] = 0;
+		vector<task> small, big_tasks(1, task(0, VI(N)));
+		FOR(v,0,N) big_tasks[0].second[v] = v;
+		while( !big_tasks.empty() ) {   // phase 1: parallelism inside each task
+			task T = move(big_tasks.back());   big_tasks.pop_back();
+			vector<task> out;
+			fb_step(col, din, dout, comp, n_cols, n_comps, T, &pool, out);
+			FOR(i,0,out.size()) (out[i].second.size() >= big ? big_tasks : small).push_back(move(out[i]));
+		}
+		// phase 2: one task per thread; idle threads steal from the others
+		vector<deque<task>> dq(threads);   vector<mutex> mu(threads);
+		atomic<size_t> pending(small.size());
+		FOR(i,0,small.size()) dq[i % threads].push_back(move(small[i]));
+		pool.run([&]( size_t t ) {
+			while( pending > 0 ) {
+				task T;   bool got = false;
+				FOR(k,0,threads) {
+					size_t u = (t+k) % threads;
+					lock_guard<mutex> lock(mu[u]);
+					if( dq[u].empty() ) continue;
+					if( u == t ) { T = move(dq[u].back());  dq[u].pop_back(); }
+					else         { T = move(dq[u].front()); dq[u].pop_front(); }
+					got = true;   break;
+				}
+				if( !got ) { this_thread::yield(); continue; }
+				vector<task> out;
+				fb_step(col, din, dout, comp, n_cols, n_comps, T, 0, out);
+				pending += out.size();
+				{
+					lock_guard<mutex> lock(mu[t]);
+					FOR(i,0,out.size()) dq[t].push_back(move(out[i]));
 				}
+				--pending;
+			}
+		});
+		// number the components in topological order (Kahn's algorithm)
+		n_sccs = n_comps;
+		VI start(n_sccs+1, 0), by_comp(N), indeg(n_sccs, 0), order;
+		FOR(v,0,N) ++start[comp[v]+1];
+		FOR(k,0,n_sccs) start[k+1] += start[k];
+		{ VI at(start);   FOR(v,0,N) by_comp[at[comp[v]]++] = v; }
+		FOR(v,0,N) FOR(i,0,A[v].size()) if( comp[A[v][i]] != comp[v] ) ++indeg[comp[A[v][i]]];
+		FOR(k,0,n_sccs) if( indeg[k] == 0 ) order.push_back(k);
+		FOR(j,0,order.size()) {
+			size_t k = order[j];
+			FOR(i,start[k],start[k+1]) {
+				size_t v = by_comp[i];
+				FOR(e,0,A[v].size()) {
+					size_t x = comp[A[v][e]];
+					if( x != k && --indeg[x] == 0 ) order.push_back(x);
+				}
+			}
+		}
+		VI label(n_sccs);
+		FOR(j,0,n_sccs) label[order[j]] = j;
+		FOR(v,0,N) scc[v] = label[comp[v]];
+	}
+	// Incremental mode. After compute_sccs, start_incremental() builds the
+	// condensation; add_edge_incremental then keeps the components and a
+	// topological order of them up to date (Pearce-Kelly): only components
+	// ordered between the edge's endpoints are searched, and components are
+	// merged only when the edge closes a cycle. component(v) is the current
+	// component of v; update_sccs() rewrites scc and n_sccs, in topological
+	// order, for use with compute_scc_graph.
+	VI base, uf, ord, mf, mb;   VVI dag_out, dag_in;   size_t stamp;
+	void start_incremental() {
+		base = scc;   uf = ord = VI(n_sccs);   dag_out = dag_in = VVI(n_sccs);
+		mf = mb = VI(n_sccs, 0);   stamp = 0;
+		FOR(k,0,n_sccs) uf[k] = ord[k] = k;
+		FOR(v,0,N) FOR(i,0,A[v].size()) {
+			size_t x = scc[v], y = scc[A[v][i]];
+			if( x != y ) { dag_out[x].push_back(y); dag_in[y].push_back(x); }
+		}
+	}
+	size_t component( size_t v ) { return find(uf, base[v]); }
+	// components reachable from r along E through nodes k with ok(k), marked in m
+	template<class OK> VI search( size_t r, VVI &E, VI &m, OK ok ) {
+		VI seen(1, r), st(1, r);   m[r] = stamp;
+		while( !st.empty() ) {
+			size_t k = st.back();   st.pop_back();
+			FOR(i,0,E[k].size()) {
+				size_t j = find(uf, E[k][i]);
+				if( m[j] == stamp || !ok(j) ) continue;
+				m[j] = stamp;   seen.push_back(j);   st.push_back(j);
 			}
 		}
+		return seen;
+	}
+	void add_edge_incremental( size_t s, size_t t ) {
+		add_edge(s, t);
+		size_t x = component(s), y = component(t);
+		if( x == y ) return;
+		dag_out[x].push_back(y);   dag_in[y].push_back(x);
+		if( ord[x] < ord[y] ) return;
+		++stamp;
+		const size_t lo = ord[y], hi = ord[x];
+		VI F  = search(y, dag_out, mf, [&]( size_t k ) { return ord[k] <= hi; });
+		VI Bk = search(x, dag_in,  mb, [&]( size_t k ) { return ord[k] >= lo; });
+		// Reuse the positions of F and Bk: nodes only in Bk take the lowest
+		// ones, then the merged component (if any), and nodes only in F the
+		// highest ones, so that no edge from outside F and Bk is broken.
+		VI pool, seq;
+		FOR(i,0,F.size())  pool.push_back(ord[F[i]]);
+		FOR(i,0,Bk.size()) if( mf[Bk[i]] != stamp ) pool.push_back(ord[Bk[i]]);
+		sort(pool.begin(), pool.end());
+		auto by_ord = [&]( size_t a, size_t b ) { return ord[a] < ord[b]; };
+		sort(F.begin(), F.end(), by_ord);   sort(Bk.begin(), Bk.end(), by_ord);
+		FOR(i,0,Bk.size()) if( mf[Bk[i]] != stamp ) seq.push_back(Bk[i]);
+		if( mf[x] == stamp ) { // x reaches y and back: merge F and Bk's common part
+			size_t r = x;
+			FOR(i,0,F.size()) if( mb[F[i]] == stamp && dag_out[F[i]].size() > dag_out[r].size() ) r = F[i];
+			FOR(i,0,F.size()) {
+				size_t c = F[i];
+				if( mb[c] != stamp || c == r ) continue;
+				merge(uf, c, r);   --n_sccs;
+				dag_out[r].insert(dag_out[r].end(), dag_out[c].begin(), dag_out[c].end());
+				dag_in[r].insert(dag_in[r].end(), dag_in[c].begin(), dag_in[c].end());
+				VI().swap(dag_out[c]);   VI().swap(dag_in[c]);
+			}
+			seq.push_back(r);
+		}
+		FOR(i,0,seq.size()) ord[seq[i]] = pool[i];
+		seq.clear();
+		FOR(i,0,F.size()) if( mb[F[i]] != stamp ) seq.push_back(F[i]);
+		FOR(i,0,seq.size()) ord[seq[i]] = pool[pool.size()-seq.size()+i];
+	}
+	void update_sccs() {
+		VI roots;
+		FOR(k,0,uf.size()) if( (size_t)find(uf, k) == k ) roots.push_back(k);
+		sort(roots.begin(), roots.end(), [&]( size_t a, size_t b ) { return ord[a] < ord[b]; });
+		VI label(uf.size());
+		FOR(i,0,roots.size()) label[roots[i]] = i;
+		FOR(v,0,N) scc[v] = label[component(v)];
+		n_sccs = roots.size();
+	}
+	// The condensation as a CSR DAG without duplicate edges or self-loops,
+	// built by counting sort on the source component in O(N + E) with a few
+	// flat arrays. Components are already numbered in topological order, so
+	// topo is simply 0, 1, ..., n_sccs-1; it is returned for convenience.
+	csr_graph<> compute_scc_dag( VI &topo ) {
+		csr_graph<> H(n_sccs, vector<pair<size_t,size_t>>());
+		VI &off = H.off, &to = H.to, last(n_sccs, n_sccs);
+		FOR(v,0,N) FOR(i,0,A[v].size()) if( scc[A[v][i]] != scc[v] ) ++off[scc[v]+1];
+		FOR(k,0,n_sccs) off[k+1] += off[k];
+		to.resize(off[n_sccs]);
+		{
+			VI pos(off.begin(), off.end()-1);
+			FOR(v,0,N) FOR(i,0,A[v].size()) {
+				size_t x = scc[v], y = scc[A[v][i]];
+				if( x != y ) to[pos[x]++] = y;
+			}
+		}
+		size_t m = 0;   // compact each row, keeping the first copy of each target
+		FOR(k,0,n_sccs) {
+			size_t b = off[k];   off[k] = m;
+			FOR(i,b,off[k+1]) if( last[to[i]] != k ) { last[to[i]] = k;   to[m++] = to[i]; }
+		}
+		off[n_sccs] = m;   to.resize(m);   to.shrink_to_fit();
+		topo.resize(n_sccs);
+		FOR(k,0,n_sccs) topo[k] = k;
+		return H;
+	}
+	void compute_scc_graph( graph_t<> &H ) {
+		VI topo;   csr_graph<> D = compute_scc_dag(topo);
+		H = graph_t<>(n_sccs);
+		FOR(k,0,n_sccs) FOR(i,D.off[k],D.off[k+1]) H.add_edge(k, D.to[i]);
 	}
 };
+typedef graph_t<> graph;
 // END
 
 #include <iostream>
 #include <set>
 #include <cassert>
+#include <cstdlib>
 
 bool graph_has_edge( graph &G, size_t u, size_t v ) {
   assert( 0 <= u && u < G.N );
@@ -136,8 +390,199 @@ void test_scc_correct() {
 	}
 }
 
+void test_scc_csr() {
+	cerr << "test SCC on a csr_graph" << endl;
+	vector<pair<size_t,size_t>> edges = {{0,1}, {1,2}, {2,0}, {1,3}, {3,4}, {0,4}, {4,5}, {5,4}};
+	graph G(6);
+	FOR(i,0,edges.size()) G.add_edge(edges[i].first, edges[i].second);
+	G.compute_sccs();
+	csr_graph<> C(6, edges);
+	graph_t<csr_rows<size_t>> H(C.adj());
+	H.compute_sccs();
+	if( H.n_sccs != G.n_sccs || H.scc != G.scc ) {
+		cerr << "SCCs computed on csr_graph differ from those on graph" << endl;
+	}
+	graph S(0), T(0); G.compute_scc_graph(S); H.compute_scc_graph(T);
+	if( S.A != T.A ) {
+		cerr << "SCC graph computed on csr_graph differs from that on graph" << endl;
+	}
+}
+
+// every edge must go forward in the labeling, and there must be the expected
+// number of components (if known)
+void test_scc_random() {
+	cerr << "test SCC against transitive closure" << endl;
+	FOR(t,0,200) {
+		size_t n = 1 + rand()%30, m = rand()%60;
+		graph G(n);   vector<VB> R(n, VB(n,false));
+		FOR(v,0,n) R[v][v] = true;
+		FOR(i,0,m) { size_t s = rand()%n, u = rand()%n; G.add_edge(s,u); R[s][u] = true; }
+		FOR(k,0,n) FOR(i,0,n) FOR(j,0,n) if( R[i][k] && R[k][j] ) R[i][j] = true;
+		G.compute_sccs();
+		FOR(i,0,n) FOR(j,0,n) {
+			if( (G.scc[i] == G.scc[j]) != (R[i][j] && R[j][i]) ) {
+				cerr << "(random test #" << t << ") nodes " << i << " and " << j << " mislabeled" << endl;
+			}
+			if( R[i][j] && G.scc[i] > G.scc[j] ) {
+				cerr << "(random test #" << t << ") components not in topological order" << endl;
+			}
+		}
+	}
+}
+
+void test_scc_dag() {
+	cerr << "test SCC DAG" << endl;
+	FOR(t,0,200) {
+		size_t n = 1 + rand()%40, m = rand()%(3*n);
+		graph G(n);
+		FOR(i,0,m) G.add_edge(rand()%n, rand()%n);
+		G.compute_sccs();
+		VI topo;   csr_graph<> D = G.compute_scc_dag(topo);
+		set<pair<size_t,size_t>> exp, got;
+		FOR(v,0,n) FOR(i,0,G.A[v].size()) if( G.scc[v] != G.scc[G.A[v][i]] ) exp.insert(make_pair(G.scc[v], G.scc[G.A[v][i]]));
+		FOR(k,0,G.n_sccs) FOR(i,D.off[k],D.off[k+1]) got.insert(make_pair(k, D.to[i]));
+		if( got != exp || D.to.size() != exp.size() ) {
+			cerr << "(DAG test #" << t << ") wrong or duplicate edges in SCC DAG" << endl;
+		}
+		VI pos(G.n_sccs);
+		FOR(i,0,topo.size()) pos[topo[i]] = i;
+		FOR(k,0,G.n_sccs) FOR(i,D.off[k],D.off[k+1]) if( pos[k] >= pos[D.to[i]] ) {
+			cerr << "(DAG test #" << t << ") topo is not a topological order" << endl;
+		}
+	}
+}
+
+// true if a and b partition the nodes into the same classes
+bool same_partition( const VI &a, const VI &b ) {
+	if( a.size() != b.size() ) return false;
+	size_t n = a.size();   VI ab(n+1, n), ba(n+1, n);
+	FOR(v,0,n) {
+		if( ab[a[v]] == n ) ab[a[v]] = b[v];
+		if( ba[b[v]] == n ) ba[b[v]] = a[v];
+		if( ab[a[v]] != b[v] || ba[b[v]] != a[v] ) return false;
+	}
+	return true;
+}
+
+void test_scc_incremental() {
+	cerr << "test incremental SCC" << endl;
+	FOR(t,0,100) {
+		size_t n = 1 + rand()%60;
+		graph G(n), H(n);
+		FOR(i,0,rand()%n) { size_t s = rand()%n, u = rand()%n; G.add_edge(s,u); H.add_edge(s,u); }
+		G.compute_sccs();   G.start_incremental();
+		FOR(i,0,2*n) {
+			size_t s = rand()%n, u = rand()%n;
+			G.add_edge_incremental(s, u);   H.add_edge(s, u);
+			H.compute_sccs();
+			VI comp(n);
+			FOR(v,0,n) comp[v] = G.component(v);
+			if( !same_partition(comp, H.scc) ) {
+				cerr << "(incremental test #" << t << ") components differ after adding " << s << "->" << u << endl;
+				break;
+			}
+		}
+		G.update_sccs();
+		if( G.n_sccs != H.n_sccs ) cerr << "(incremental test #" << t << ") wrong number of SCCs" << endl;
+		FOR(v,0,n) FOR(i,0,G.A[v].size()) if( G.scc[G.A[v][i]] < G.scc[v] ) {
+			cerr << "(incremental test #" << t << ") components not in topological order" << endl;
+		}
+	}
+}
+
+void test_scc_parallel() {
+	cerr << "test parallel SCC" << endl;
+	FOR(t,0,300) {
+		size_t n = 1 + rand()%200, m = rand()%(3*n);
+		graph G(n);
+		FOR(i,0,m) G.add_edge(rand()%n, rand()%n);
+		G.compute_sccs();
+		VI seq = G.scc;   size_t n_seq = G.n_sccs;
+		G.compute_sccs_parallel(1 + t%4, 1 + rand()%50);
+		if( G.n_sccs != n_seq || !same_partition(seq, G.scc) ) {
+			cerr << "(parallel test #" << t << ") components differ from compute_sccs" << endl;
+		}
+		FOR(v,0,n) FOR(i,0,G.A[v].size()) if( G.scc[G.A[v][i]] < G.scc[v] ) {
+			cerr << "(parallel test #" << t << ") components not in topological order" << endl;
+		}
+	}
+}
+
+void check_scc_order( graph_t<csr_rows<size_t>> &G, size_t expected, const char *name ) {
+	FOR(v,0,G.N) FOR(i,0,G.A[v].size()) {
+		if( G.scc[G.A[v][i]] < G.scc[v] ) {
+			cerr << "(" << name << ") edge " << v << "->" << G.A[v][i] << " goes backwards between components" << endl;
+			return;
+		}
+	}
+	if( expected != 0 && G.n_sccs != expected ) {
+		cerr << "(" << name << ") expected " << expected << " SCCs, got " << G.n_sccs << endl;
+	}
+}
+
+void test_scc_speed() {
+	const size_t N = 10000000;
+	vector<pair<size_t,size_t>> edges;
+	FOR(i,0,N-1) edges.push_back(make_pair(i, i+1));
+	{
+		csr_graph<> C(N, edges);
+		graph_t<csr_rows<size_t>> G(C.adj());
+		cerr << "Start speed test on a path with " << N << " nodes..." << endl;
+		G.compute_sccs();
+		cerr << "End speed test." << endl;
+		check_scc_order(G, N, "path");
+		csr_graph<> R = C.reversed();
+		graph_t<csr_rows<size_t>> H(C.adj(), R.adj());
+		cerr << "Start parallel speed test on the path..." << endl;
+		H.compute_sccs_parallel(max(1u, thread::hardware_concurrency()));
+		cerr << "End speed test." << endl;
+		check_scc_order(H, N, "path, parallel");
+	}
+	edges.push_back(make_pair(N-1, 0));
+	{
+		csr_graph<> C(N, edges);
+		graph_t<csr_rows<size_t>> G(C.adj());
+		cerr << "Start speed test on a cycle with " << N << " nodes..." << endl;
+		G.compute_sccs();
+		cerr << "End speed test." << endl;
+		check_scc_order(G, 1, "cycle");
+		csr_graph<> R = C.reversed();
+		graph_t<csr_rows<size_t>> H(C.adj(), R.adj());
+		FOR(threads,1,5) {
+			cerr << "Start parallel speed test on the cycle with " << threads << " threads..." << endl;
+			H.compute_sccs_parallel(threads);
+			cerr << "End speed test." << endl;
+			check_scc_order(H, 1, "cycle, parallel");
+		}
+	}
+	const size_t M = 1000000, D = 5;
+	edges.clear();
+	FOR(i,0,M) FOR(d,0,D) edges.push_back(make_pair(i, rand() % M));
+	{
+		csr_graph<> C(M, edges), R = C.reversed();
+		graph_t<csr_rows<size_t>> G(C.adj(), R.adj());
+		cerr << "Start speed test on a random graph with " << M << " nodes, " << M*D << " edges..." << endl;
+		G.compute_sccs();
+		cerr << "End speed test." << endl;
+		check_scc_order(G, 0, "random");
+		VI seq = G.scc;
+		size_t threads = max(1u, thread::hardware_concurrency());
+		cerr << "Start parallel speed test with " << threads << " threads..." << endl;
+		G.compute_sccs_parallel(threads);
+		cerr << "End speed test." << endl;
+		if( !same_partition(seq, G.scc) ) cerr << "(random) parallel SCCs differ" << endl;
+		check_scc_order(G, 0, "random, parallel");
+	}
+}
+
 int main() {
 	test_scc_correct();
+	test_scc_csr();
+	test_scc_random();
+	test_scc_dag();
+	test_scc_parallel();
+	test_scc_incremental();
+	test_scc_speed();
 	return 0;
 }
 
@@ -2,96 +2,375 @@
 #include <algorithm>
 #include <string>
 #include <cstring>
+#include <thread>
+#include <cstdio>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ThreadPool.cc"
 using namespace std;
 
 // BEGIN
-// A prefix-doubling suffix array construction implementation.
+// SA-IS suffix array construction in O(n), along with LCP and pattern search.
+// Everything works on caller-owned arrays of a signed index type I: use int
+// for texts shorter than 2^31 characters and long long for longer ones.
 #define FOR(v,l,u) for( size_t v = l; v < u; ++v )
 
 typedef vector<size_t> VI;
-typedef pair<int, int> II;
-
-#define MAX_N 100010
-int RA[MAX_N], tempRA[MAX_N];
-int SA[MAX_N], tempSA[MAX_N];
-int c[MAX_N];
-
-// uses Radix Sort as a subroutine to sort in O(n)
-void CountingSort(int n, int k) {
-    int i, sum, maxi = max(300, n);
-    memset(c, 0, sizeof c);
-    for (i = 0; i < n; i++)
-        c[i+k < n ? RA[i+k] : 0]++;
-    for (i = sum = 0; i < maxi; i++) {
-        int t = c[i]; c[i] = sum; sum += t;
-    }
-    for (i = 0; i < n; i++)
-        tempSA[c[SA[i]+k < n ? RA[SA[i]+k] : 0]++] = SA[i];
-    for (i = 0; i < n; i++)
-        SA[i] = tempSA[i];
-}
-
-// Construct SA in O(n log n) time. Solves UVa Online Judge "Glass Beads" in .5 seconds
-void ConstructSA(string T) {
-    int i, k, r, n = T.size();
-    for (i = 0; i < n; i++) RA[i] = T[i];
-    for (i = 0; i < n; i++) SA[i] = i;
-    for (k = 1; k < n; k <<= 1) {
-        CountingSort(n, k);
-        CountingSort(n, 0);
-        tempRA[SA[0]] = r = 0;
-        for (i = 1; i < n; i++)
-            tempRA[SA[i]] =
-                (RA[SA[i]] == RA[SA[i-1]] && RA[SA[i]+k] == RA[SA[i-1]+k]) ? r : ++r;
-        for (i = 0; i < n; i++)
-            RA[i] = tempRA[i];
-        if (RA[SA[n-1]] == n-1) break;
-    }
+
+// Computes the suffix array of s[0..n-1], where 0 <= s[i] <= upper.
+template<class I> vector<I> SAIS( const vector<I> &s, I upper ) {
+	I n = s.size();
+	if( n <= 2 ) {
+		vector<I> sa(n);
+		for( I i = 0; i < n; ++i ) sa[i] = i;
+		if( n == 2 && s[0] >= s[1] ) swap(sa[0], sa[1]);
+		return sa;
+	}
+	vector<I> sa(n), sum_l(upper+1), sum_s(upper+1), buf(upper+1);
+	vector<bool> ls(n); // ls[i] is true if suffix i is S-type
+	for( I i = n-2; i >= 0; --i )
+		ls[i] = (s[i] == s[i+1]) ? ls[i+1] : (s[i] < s[i+1]);
+	for( I i = 0; i < n; ++i ) {
+		if( !ls[i] ) sum_s[s[i]]++;
+		else         sum_l[s[i]+1]++;
+	}
+	for( I i = 0; i <= upper; ++i ) {
+		sum_s[i] += sum_l[i];
+		if( i < upper ) sum_l[i+1] += sum_s[i];
+	}
+	// induced sorting of all suffixes from the given order of LMS suffixes
+	auto induce = [&]( const vector<I> &lms ) {
+		fill(sa.begin(), sa.end(), -1);
+		copy(sum_s.begin(), sum_s.end(), buf.begin());
+		for( I d : lms ) sa[buf[s[d]]++] = d;
+		copy(sum_l.begin(), sum_l.end(), buf.begin());
+		sa[buf[s[n-1]]++] = n-1;
+		for( I i = 0; i < n; ++i ) {
+			I v = sa[i];
+			if( v >= 1 && !ls[v-1] ) sa[buf[s[v-1]]++] = v-1;
+		}
+		copy(sum_l.begin(), sum_l.end(), buf.begin());
+		for( I i = n-1; i >= 0; --i ) {
+			I v = sa[i];
+			if( v >= 1 && ls[v-1] ) sa[--buf[s[v-1]+1]] = v-1;
+		}
+	};
+	vector<I> lms_map(n+1, -1), lms;
+	for( I i = 1; i < n; ++i ) if( !ls[i-1] && ls[i] ) { lms_map[i] = lms.size(); lms.push_back(i); }
+	I m = lms.size();
+	induce(lms);
+	if( m == 0 ) return sa;
+	// name the LMS substrings and recursively sort them
+	vector<I> sorted_lms, rec_s(m);
+	for( I v : sa ) if( lms_map[v] != -1 ) sorted_lms.push_back(v);
+	I rec_upper = 0;
+	rec_s[lms_map[sorted_lms[0]]] = 0;
+	for( I i = 1; i < m; ++i ) {
+		I l = sorted_lms[i-1], r = sorted_lms[i];
+		I end_l = (lms_map[l]+1 < m) ? lms[lms_map[l]+1] : n;
+		I end_r = (lms_map[r]+1 < m) ? lms[lms_map[r]+1] : n;
+		bool same = (end_l - l == end_r - r);
+		if( same ) {
+			while( l < end_l && s[l] == s[r] ) { ++l; ++r; }
+			if( l == n || s[l] != s[r] ) same = false;
+		}
+		if( !same ) ++rec_upper;
+		rec_s[lms_map[sorted_lms[i]]] = rec_upper;
+	}
+	vector<I> rec_sa = SAIS(rec_s, rec_upper);
+	for( I i = 0; i < m; ++i ) sorted_lms[i] = lms[rec_sa[i]];
+	induce(sorted_lms);
+	return sa;
 }
 
-// Given a "string" w, and suffix array SA, compute the array LCP for which
-// the suffix starting at SA[i] matches SA[i+1] for exactly LCP[i] characters
-// It is assumed that the last character of w is the unique smallest-rank
-// character in w. Runs in O(n).
-void LongestCommonPrefix( const string &w, VI &LCP ) {
-	const size_t N = w.size();   VI rk(N);
+// SA[i] is the starting position of the i-th smallest suffix of T.
+template<class I> void ConstructSA( const string &T, vector<I> &SA ) {
+	vector<I> s(T.size());
+	FOR(i,0,T.size()) s[i] = (unsigned char)T[i];
+	SA = SAIS(s, (I)255);
+}
+
+// Stable LSD radix sort of a by .first, which must be below 2^bits, 11 bits
+// per pass; b is scratch space of the same size. In each pass every thread
+// counts the digits of its range, and then scatters the range to the offsets
+// the prefix sums of those counts give it.
+template<class I> void RadixSortPairs( vector<pair<I,I>> &a, vector<pair<I,I>> &b, size_t bits, thread_pool &P ) {
+	const size_t n = a.size(), D = 1 << 11;
+	vector<size_t> cnt(P.threads * D);
+	for( size_t sh = 0; sh < bits; sh += 11 ) {
+		fill(cnt.begin(), cnt.end(), 0);
+		split_range(&P, n, [&]( size_t t, size_t lo, size_t hi ) {
+			size_t *c = &cnt[t*D];
+			FOR(i,lo,hi) ++c[((size_t)a[i].first >> sh) & (D-1)];
+		});
+		size_t sum = 0;
+		FOR(d,0,D) FOR(t,0,P.threads) { size_t x = cnt[t*D + d];   cnt[t*D + d] = sum;   sum += x; }
+		split_range(&P, n, [&]( size_t t, size_t lo, size_t hi ) {
+			size_t *c = &cnt[t*D];
+			FOR(i,lo,hi) b[c[((size_t)a[i].first >> sh) & (D-1)]++] = a[i];
+		});
+		a.swap(b);
+	}
+}
+
+// Multi-threaded prefix doubling. Round k starts from the suffixes in order
+// of their ranks rk[i+k], which the last round's SA gives directly, and
+// stable radix sorts them by rk[i]; ranks are then recomputed with a
+// parallel prefix sum. Each round is O(n log(n) / 11) work spread over the
+// threads, and there is one round per doubling of the longest repeat, so
+// this is O(n log^2 n) only for very repetitive texts. threads == 0 is
+// taken as 1.
+template<class I> void ConstructSAParallel( const string &T, vector<I> &SA, size_t threads ) {
+	const size_t n = T.size();
+	thread_pool P(threads);
+	vector<pair<I,I>> a(n), b(n);
+	vector<I> rk(n), tmp(n);   vector<size_t> cnt(P.threads+1);
+	SA.resize(n);
+	split_range(&P, n, [&]( size_t, size_t lo, size_t hi ) {
+		FOR(i,lo,hi) { a[i] = make_pair((I)(unsigned char)T[i], (I)i);   rk[i] = (unsigned char)T[i]; }
+	});
+	for( size_t k = 0, bits = 8; ; k = k ? 2*k : 1 ) {
+		if( k > 0 ) {
+			// suffixes with i+k >= n are already alone in their group and go first
+			size_t m = min(k, n);
+			FOR(i,0,m) a[i] = make_pair(rk[n-m+i], (I)(n-m+i));
+			fill(cnt.begin(), cnt.end(), 0);
+			split_range(&P, n, [&]( size_t t, size_t lo, size_t hi ) {
+				FOR(i,lo,hi) cnt[t+1] += (size_t)SA[i] >= k;
+			});
+			FOR(t,0,P.threads) cnt[t+1] += cnt[t];
+			split_range(&P, n, [&]( size_t t, size_t lo, size_t hi ) {
+				size_t j = m + cnt[t];
+				FOR(i,lo,hi) if( (size_t)SA[i] >= k ) { I x = SA[i]-k;   a[j++] = make_pair(rk[x], x); }
+			});
+		}
+		RadixSortPairs(a, b, bits, P);
+		auto differ = [&]( I x, I y ) {
+			return rk[x] != rk[y] || (k > 0 && (x+k < n ? rk[x+k] : -1) != (y+k < n ? rk[y+k] : -1));
+		};
+		// cnt[t+1] = number of rank increases within piece t
+		fill(cnt.begin(), cnt.end(), 0);
+		split_range(&P, n, [&]( size_t t, size_t lo, size_t hi ) {
+			FOR(i,max(lo,(size_t)1),hi) cnt[t+1] += differ(a[i-1].second, a[i].second);
+		});
+		FOR(t,0,P.threads) cnt[t+1] += cnt[t];
+		split_range(&P, n, [&]( size_t t, size_t lo, size_t hi ) {
+			I r = cnt[t];
+			FOR(i,lo,hi) {
+				if( i > 0 && differ(a[i-1].second, a[i].second) ) ++r;
+				tmp[a[i].second] = r;   SA[i] = a[i].second;
+			}
+		});
+		swap(rk, tmp);
+		size_t groups = n ? cnt[P.threads] + 1 : 0;
+		if( groups == n ) break;
+		for( bits = 0; ((size_t)1 << bits) < groups; ++bits ) ;
+	}
+}
+
+// Given a string w and its suffix array SA, compute the array LCP for which
+// the suffix starting at SA[i] matches SA[i+1] for exactly LCP[i] characters.
+// Runs in O(n).
+template<class I> void LongestCommonPrefix( const string &w, const vector<I> &SA, vector<I> &LCP ) {
+	const size_t N = w.size();   vector<I> rk(N);
 	FOR(i,0,N) rk[ SA[i] ] = i;
-	LCP = VI(N-1);   size_t k = 0;
+	LCP = vector<I>(N ? N-1 : 0);   size_t k = 0;
 	FOR(i,0,N) {
-		if( rk[i] == N-1 ) continue;
+		if( (size_t)rk[i] == N-1 ) { k = 0; continue; }
 		size_t j = SA[ rk[i]+1 ];
-		while( w[ i+k ] == w[ j+k ] ) ++k;
+		while( i+k < N && j+k < N && w[ i+k ] == w[ j+k ] ) ++k;
 		LCP[ rk[i] ] = k;
 		if( k > 0 ) --k;
 	}
 }
+// Compares the suffix of T[0..n-1] starting at i, cut to |P| characters, with P,
+// in the same way as string::compare(i, |P|, P).
+template<class I> int CompareSuffix( const char *T, I n, I i, const string &P ) {
+	I len = min((I)P.size(), n-i);
+	int r = memcmp(T+i, P.data(), len);
+	return r != 0 ? r : (len < (I)P.size() ? -1 : 0);
+}
 // Finds the smallest and largest i such that the prefix of suffix SA[i] matches
 // the pattern string P. Returns (-1, -1) if P is not found in T. Runs in O(m log n).
-II StringMatching(const string &T, const string P) {
-    int n = T.size(), m = P.size();
-    int lo = 0, hi = n-1, mid = lo;
+template<class I> pair<I,I> StringMatching( const char *T, I n, const I *SA, const string &P ) {
+    if (n == 0) return pair<I,I>(-1, -1);
+    I lo = 0, hi = n-1, mid = lo;
     while (lo < hi) {
         mid = (lo + hi) / 2;
-        int res = T.compare(SA[mid], m, P);
+        int res = CompareSuffix(T, n, SA[mid], P);
         if (res >= 0) hi = mid;
         else          lo = mid+1;
     }
-    if (T.compare(SA[lo], m, P) != 0) return II(-1, -1);
-    II ans; ans.first = lo;
+    if (CompareSuffix(T, n, SA[lo], P) != 0) return pair<I,I>(-1, -1);
+    pair<I,I> ans; ans.first = lo;
     lo = 0; hi = n-1; mid = lo;
     while (lo < hi) {
         mid = (lo + hi) / 2;
-        int res = T.compare(SA[mid], m, P);
+        int res = CompareSuffix(T, n, SA[mid], P);
         if (res > 0) hi = mid;
         else         lo = mid+1;
     }
-    if (T.compare(SA[hi], m, P)) hi--;
+    if (CompareSuffix(T, n, SA[hi], P)) hi--;
     ans.second = hi;
     return ans;
 }
+template<class I> pair<I,I> StringMatching( const string &T, const vector<I> &SA, const string &P ) {
+    return StringMatching(T.data(), (I)T.size(), SA.data(), P);
+}
+
+// LCP-LR search (Manber-Myers). For every midpoint M = (L+R)/2 visited by a
+// binary search over [0, n-1], LL[M] and RL[M] hold the LCP of suffixes SA[L],
+// SA[M] and of SA[M], SA[R]. With them each search step compares characters
+// only past the part already known to match, for O(m + log n) per pattern.
+template<class I> I BuildLCPLR( const I *LCP, I L, I R, vector<I> &LL, vector<I> &RL ) {
+	if( R-L <= 1 ) return LCP[L];
+	I M = (L+R)/2;
+	LL[M] = BuildLCPLR(LCP, L, M, LL, RL);
+	RL[M] = BuildLCPLR(LCP, M, R, LL, RL);
+	return min(LL[M], RL[M]);
+}
+template<class I> void BuildLCPLR( const I *LCP, I n, vector<I> &LL, vector<I> &RL ) {
+	LL.assign(n, 0);   RL.assign(n, 0);
+	if( n > 1 ) BuildLCPLR(LCP, (I)0, n-1, LL, RL);
+}
+// Extends the match of suffix i against P from k known-equal characters.
+// Returns whether the cut suffix is less than (-1), equal to (0) or greater
+// than (1) P, and updates k to the length of the match.
+template<class I> int ExtendMatch( const char *T, I n, I i, const string &P, I &k ) {
+	I m = P.size();
+	while( k < m && i+k < n && T[i+k] == P[k] ) ++k;
+	if( k == m ) return 0;
+	if( i+k == n ) return -1;
+	return (unsigned char)T[i+k] < (unsigned char)P[k] ? -1 : 1;
+}
+// First index whose suffix, cut to |P| characters, is >= P (or > P if upper).
+template<class I> I LCPLRBound( const char *T, I n, const I *SA, const I *LL,
+                                const I *RL, const string &P, bool upper ) {
+	auto left = [&]( int c ) { return c < 0 || (upper && c == 0); }; // suffix goes left of the bound
+	I L = 0, R = n-1, l = 0, r = 0;
+	if( !left(ExtendMatch(T, n, SA[L], P, l)) ) return 0;
+	if( left(ExtendMatch(T, n, SA[R], P, r)) ) return n;
+	while( R-L > 1 ) {
+		I M = (L+R)/2, k;
+		if( l >= r && LL[M] != l ) {
+			if( LL[M] > l ) L = M;
+			else { R = M; r = LL[M]; }
+		}
+		else if( l < r && RL[M] != r ) {
+			if( RL[M] > r ) R = M;
+			else { L = M; l = RL[M]; }
+		}
+		else {
+			k = max(l, r);
+			if( left(ExtendMatch(T, n, SA[M], P, k)) ) { L = M; l = k; }
+			else                                       { R = M; r = k; }
+		}
+	}
+	return R;
+}
+// Same result as StringMatching, using the LCP-LR arrays from BuildLCPLR.
+template<class I> pair<I,I> StringMatching( const char *T, I n, const I *SA, const I *LL,
+                                            const I *RL, const string &P ) {
+	if( n == 0 ) return pair<I,I>(-1, -1);
+	I lo = LCPLRBound(T, n, SA, LL, RL, P, false), hi = LCPLRBound(T, n, SA, LL, RL, P, true) - 1;
+	return lo <= hi ? pair<I,I>(lo, hi) : pair<I,I>(-1, -1);
+}
+// Answers many patterns at once, split across the given number of threads
+// (0 is taken as 1).
+template<class I> vector<pair<I,I>> StringMatching( const char *T, I n, const I *SA, const I *LL,
+                                                    const I *RL, const vector<string> &Ps, size_t threads = 1 ) {
+	vector<pair<I,I>> ans(Ps.size());
+	thread_pool P(threads);
+	split_range(&P, Ps.size(), [&]( size_t, size_t lo, size_t hi ) {
+		FOR(i,lo,hi) ans[i] = StringMatching(T, n, SA, LL, RL, Ps[i]);
+	}, 1);
+	return ans;
+}
+
+// On-disk index: a header followed by the text, SA, LCP and the LCP-LR arrays
+// LL and RL, each padded to a multiple of 8 bytes. Loading maps the file
+// read-only, so it takes O(1) time, the pages are shared between all
+// processes using the same index, and searches get the O(m + log n) bound.
+struct sa_header {
+	char magic[8];       // "SAINDEX"
+	uint32_t version;    // currently 2
+	uint32_t width;      // sizeof(I)
+	uint64_t n;          // length of the text
+};
+inline size_t pad8( size_t x ) { return (x + 7) / 8 * 8; }
+
+// Returns false if the file could not be written.
+template<class I> bool SaveIndex( const char *fn, const string &T, const vector<I> &SA, const vector<I> &LCP ) {
+	sa_header h = { "SAINDEX", 2, sizeof(I), T.size() };
+	vector<I> LL, RL;   BuildLCPLR(LCP.data(), (I)T.size(), LL, RL);
+	FILE *f = fopen(fn, "wb");
+	if( f == NULL ) return false;
+	const char zero[8] = {};
+	bool ok = fwrite(&h, sizeof h, 1, f) == 1;
+	auto put = [&]( const void *p, size_t len ) {
+		ok = ok && fwrite(p, 1, len, f) == len && fwrite(zero, 1, pad8(len)-len, f) == pad8(len)-len;
+	};
+	put(T.data(), T.size());
+	put(SA.data(), SA.size() * sizeof(I));
+	put(LCP.data(), LCP.size() * sizeof(I));
+	put(LL.data(), LL.size() * sizeof(I));
+	put(RL.data(), RL.size() * sizeof(I));
+	return fclose(f) == 0 && ok;
+}
+
+// A suffix array index mapped from disk; T, SA, LCP, LL and RL point into the
+// mapping.
+template<class I> struct sa_index {
+	const char *T = NULL;   const I *SA = NULL, *LCP = NULL, *LL = NULL, *RL = NULL;   I n = 0;
+	void *data = MAP_FAILED;   size_t len = 0;
+	sa_index() {}
+	sa_index( const sa_index& ) = delete;
+	~sa_index() { close(); }
+	void close() {
+		if( data != MAP_FAILED ) munmap(data, len);
+		data = MAP_FAILED;   len = 0;   T = NULL;   SA = LCP = LL = RL = NULL;   n = 0;
+	}
+	// Returns false if the file is missing, truncated, or of another version
+	// or width. Any index opened before is closed first.
+	bool open( const char *fn ) {
+		close();
+		int fd = ::open(fn, O_RDONLY);
+		if( fd < 0 ) return false;
+		struct stat st;
+		if( fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(sa_header) ) {
+			len = st.st_size;
+			data = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+		}
+		::close(fd);
+		if( data == MAP_FAILED ) return false;
+		const sa_header *h = (const sa_header*)data;
+		size_t lcp_n = h->n ? h->n-1 : 0;
+		if( memcmp(h->magic, "SAINDEX", 8) != 0 || h->version != 2 || h->width != sizeof(I)
+			|| len < sizeof *h + pad8(h->n) + 3*pad8(h->n * sizeof(I)) + pad8(lcp_n * sizeof(I)) ) {
+			close();
+			return false;
+		}
+		n = h->n;
+		T = (const char*)(h+1);
+		SA = (const I*)(T + pad8(n));
+		LCP = (const I*)((const char*)SA + pad8(n * sizeof(I)));
+		LL = (const I*)((const char*)LCP + pad8(lcp_n * sizeof(I)));
+		RL = (const I*)((const char*)LL + pad8(n * sizeof(I)));
+		return true;
+	}
+	pair<I,I> StringMatching( const string &P ) const { return ::StringMatching(T, n, SA, LL, RL, P); }
+	vector<pair<I,I>> StringMatching( const vector<string> &Ps, size_t threads = 1 ) const {
+		return ::StringMatching(T, n, SA, LL, RL, Ps, threads);
+	}
+};
 // END
 
 #include <iostream>
+#include <cstdlib>
+#include <chrono>
 
 bool cmp_suffixes( string arry, size_t a, size_t b ) {
 	if( a == b ) return false;
@@ -101,17 +380,20 @@ bool cmp_suffixes( string arry, size_t a, size_t b ) {
 	return arry[a] < arry[b];
 }
 
+typedef vector<int> VInt;
+typedef pair<int,int> II;
+
 void test_suffix_array_correct() {
 	cerr << "test suffix array correctness" << endl;
 	{
         string s = "1213112542";
-		ConstructSA(s);
+		VInt SA; ConstructSA(s, SA);
 		FOR(i,0,9) {
 			if( !cmp_suffixes(s,SA[i],SA[i+1]) ) {
 				cerr << "suffixes " << SA[i] << " and " << SA[i+1] << " out of order." << endl;
 			}
 		}
-		VI lcp;  LongestCommonPrefix( s, lcp );
+		VInt lcp;  LongestCommonPrefix( s, SA, lcp );
 		VI rk(s.size()); FOR(i,0,s.size()) rk[ SA[i] ] = i;
 		if( lcp[ rk[0] ] != 2 ) {
 			cerr << "suffixes 0.. and " << SA[rk[0]+1] << ".. have bad lcp (exp. 2, got " << lcp[rk[0]] << "):" << endl;
@@ -125,23 +407,167 @@ void test_suffix_array_correct() {
 		}
 
         string T = "GATAGACA$";
-        ConstructSA(T);
+        ConstructSA(T, SA);
         
-        II ans = StringMatching(T, "GA");
+        II ans = StringMatching(T, SA, "GA");
         
         if (ans.first != 6 || ans.second != 7) {
             cerr << "string matching not finding match" << endl;
         }
 
-        II ans2 = StringMatching(T, "asdf");
+        II ans2 = StringMatching(T, SA, "asdf");
         if (ans2.first != -1 || ans2.second != -1) {
             cerr << "string match returned false positive on query" << endl;
         }
 	}
+	// compare against sorting the suffixes directly, for both index widths
+	FOR(t,0,500) {
+		string s(rand()%100, '?');
+		FOR(i,0,s.size()) s[i] = 'a' + rand()%(1 + t%4);
+		VInt exp(s.size());
+		FOR(i,0,s.size()) exp[i] = i;
+		sort(exp.begin(), exp.end(), [&](int a, int b) { return s.compare(a, string::npos, s, b, string::npos) < 0; });
+		VInt SA; ConstructSA(s, SA);
+		vector<long long> SA64; ConstructSA(s, SA64);
+		if( SA != exp || !equal(SA64.begin(), SA64.end(), exp.begin()) ) {
+			cerr << "suffix array of " << s << " is incorrect." << endl;
+		}
+		VInt lcp; LongestCommonPrefix(s, SA, lcp);
+		FOR(i,0,lcp.size()) {
+			int k = 0;
+			while( SA[i]+k < (int)s.size() && SA[i+1]+k < (int)s.size() && s[SA[i]+k] == s[SA[i+1]+k] ) ++k;
+			if( lcp[i] != k ) cerr << "lcp of " << s << " is incorrect at " << i << endl;
+		}
+	}
+}
+
+void test_index_file() {
+	cerr << "test suffix array index file" << endl;
+	const char *fn = "test_suffix_array.idx";
+	string T = "GATAGACA$";
+	VInt SA, LCP; ConstructSA(T, SA); LongestCommonPrefix(T, SA, LCP);
+	if( !SaveIndex(fn, T, SA, LCP) ) {
+		cerr << "could not write index file" << endl;
+		return;
+	}
+	{
+		sa_index<int> idx;
+		if( !idx.open(fn) ) {
+			cerr << "could not load index file" << endl;
+		}
+		else {
+			if( string(idx.T, idx.n) != T || !equal(SA.begin(), SA.end(), idx.SA)
+				|| !equal(LCP.begin(), LCP.end(), idx.LCP) ) {
+				cerr << "loaded index does not match the saved one" << endl;
+			}
+			if( idx.StringMatching("GA") != II(6, 7) || idx.StringMatching("asdf") != II(-1, -1) ) {
+				cerr << "string matching on loaded index failed" << endl;
+			}
+			VInt LL, RL;   BuildLCPLR(LCP.data(), (int)T.size(), LL, RL);
+			if( !equal(LL.begin(), LL.end(), idx.LL) || !equal(RL.begin(), RL.end(), idx.RL) ) {
+				cerr << "loaded LCP-LR arrays do not match" << endl;
+			}
+			vector<string> Ps;
+			FOR(i,0,T.size()) FOR(j,i,T.size()+1) Ps.push_back(T.substr(i, j-i) + "A");
+			vector<II> ans = idx.StringMatching(Ps, 0);
+			FOR(q,0,Ps.size()) if( ans[q] != StringMatching(T, SA, Ps[q]) ) {
+				cerr << "batched matching of " << Ps[q] << " on loaded index failed" << endl;
+			}
+		}
+		// reopening replaces the old mapping
+		if( !idx.open(fn) || string(idx.T, idx.n) != T ) {
+			cerr << "could not reopen index file" << endl;
+		}
+		if( idx.open("no_such_file.idx") || idx.data != MAP_FAILED || idx.n != 0 ) {
+			cerr << "failed open did not reset the index" << endl;
+		}
+	}
+	sa_index<long long> wide;
+	if( wide.open(fn) ) {
+		cerr << "index file of the wrong width was loaded" << endl;
+	}
+	remove(fn);
+}
+
+void test_lcplr_correct() {
+	cerr << "test LCP-LR string matching" << endl;
+	FOR(t,0,300) {
+		string s(1 + rand()%200, '?');
+		FOR(i,0,s.size()) s[i] = 'a' + rand()%(1 + t%4);
+		VInt SA, LCP, LL, RL; ConstructSA(s, SA); LongestCommonPrefix(s, SA, LCP);
+		BuildLCPLR(LCP.data(), (int)s.size(), LL, RL);
+		vector<string> Ps;
+		FOR(q,0,20) {
+			if( q%2 ) {
+				size_t i = rand()%s.size();
+				Ps.push_back(s.substr(i, 1 + rand()%(s.size()-i)));
+			}
+			else {
+				Ps.push_back(string(1 + rand()%6, '?'));
+				FOR(i,0,Ps.back().size()) Ps.back()[i] = 'a' + rand()%(2 + t%4);
+			}
+		}
+		vector<II> ans = StringMatching(s.data(), (int)s.size(), SA.data(), LL.data(), RL.data(), Ps, t%3);
+		FOR(q,0,Ps.size()) {
+			if( ans[q] != StringMatching(s, SA, Ps[q]) ) {
+				cerr << "LCP-LR matching of " << Ps[q] << " in " << s << " is incorrect." << endl;
+			}
+		}
+	}
+}
+
+void test_parallel_suffix_array_correct() {
+	cerr << "test parallel suffix array correctness" << endl;
+	FOR(t,0,300) {
+		string s(rand()%200, '?');
+		FOR(i,0,s.size()) s[i] = 'a' + rand()%(1 + t%4);
+		VInt exp, SA; ConstructSA(s, exp);
+		ConstructSAParallel(s, SA, t%7);   // 0 runs on one thread
+		if( SA != exp ) {
+			cerr << "parallel suffix array of " << s << " with " << t%7 << " threads is incorrect." << endl;
+		}
+	}
+	// long enough to be split between the threads
+	FOR(t,0,8) {
+		string s(20000 + rand()%20000, '?');
+		FOR(i,0,s.size()) s[i] = t%2 ? 'a' + rand()%(1 + t%4) : "abaab"[i%5];
+		VInt exp, SA; ConstructSA(s, exp);
+		ConstructSAParallel(s, SA, 1 + t%4);
+		if( SA != exp ) {
+			cerr << "parallel suffix array of a text of length " << s.size() << " with " << 1 + t%4 << " threads is incorrect." << endl;
+		}
+	}
+}
+
+double seconds_since( chrono::steady_clock::time_point start ) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void test_suffix_array_speed() {
+	string s(50000000, '?');
+	FOR(i,0,s.size()) s[i] = 'a' + rand()%4;
+	cerr << "Start speed test, n = " << s.size() << "..." << endl;
+	VInt SA; ConstructSA(s, SA);
+	cerr << "End speed test." << endl;
+
+	s.resize(5000000);
+	cerr << "Parallel construction throughput, n = " << s.size() << ":" << endl;
+	size_t max_threads = max(1u, thread::hardware_concurrency());
+	for( size_t threads = 1; threads <= max_threads; threads *= 2 ) {
+		auto start = chrono::steady_clock::now();
+		ConstructSAParallel(s, SA, threads);
+		cerr << "\t" << threads << " threads: " << s.size() / seconds_since(start) / 1e6 << " MB/s" << endl;
+	}
+	auto start = chrono::steady_clock::now();
+	ConstructSA(s, SA);
+	cerr << "\tSA-IS: " << s.size() / seconds_since(start) / 1e6 << " MB/s" << endl;
 }
 
 int main() {
 	test_suffix_array_correct();
+	test_parallel_suffix_array_correct();
+	test_index_file();
+	test_lcplr_correct();
+	test_suffix_array_speed();
 	return 0;
 }
-
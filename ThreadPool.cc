@@ -0,0 +1,90 @@
+#ifndef THREADPOOL_CC
+#define THREADPOOL_CC
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+using namespace std;
+
+// BEGIN
+// A fixed set of threads for repeated parallel steps: threads-1 helpers are
+// started once, and run(f) calls f(t) for every t = 0..threads-1 (t = 0 on
+// the caller), returning when all are done. With one thread (or 0, which is
+// treated as 1) it just calls f(0) and no threads are ever started.
+struct thread_pool {
+    size_t threads, gen, busy; bool quit;
+    const function<void(size_t)> *job;
+    mutex mu; condition_variable wake, done;
+    vector<thread> pool;
+    thread_pool(size_t n) : threads(max<size_t>(n, 1)), gen(0), busy(0), quit(false), job(0) {
+        for (size_t t = 1; t < threads; ++t) pool.push_back(thread([this, t]() {
+            for (size_t seen = 0; ; ) {
+                {
+                    unique_lock<mutex> lock(mu);
+                    wake.wait(lock, [&]() { return quit || gen != seen; });
+                    if (quit) return;
+                    seen = gen;
+                }
+                (*job)(t);
+                lock_guard<mutex> lock(mu);
+                if (--busy == 0) done.notify_one();
+            }
+        }));
+    }
+    thread_pool(const thread_pool&) = delete;
+    void run(const function<void(size_t)> &f) {
+        if (threads == 1) { f(0); return; }
+        { lock_guard<mutex> lock(mu); job = &f; busy = threads-1; ++gen; }
+        wake.notify_all();
+        f(0);
+        unique_lock<mutex> lock(mu);
+        done.wait(lock, [&]() { return busy == 0; });
+    }
+    ~thread_pool() {
+        { lock_guard<mutex> lock(mu); quit = true; }
+        wake.notify_all();
+        for (size_t t = 0; t < pool.size(); ++t) pool[t].join();
+    }
+};
+
+// runs f(t, lo, hi) over [0, n) split evenly between the threads of P, or as
+// f(0, 0, n) on the caller if there is no pool or n < grain, where splitting
+// would cost more than it saves
+template<class F> void split_range(thread_pool *P, size_t n, F f, size_t grain = 4096) {
+    if (!P || P->threads == 1 || n < grain) { f(0, 0, n); return; }
+    const size_t k = P->threads;
+    P->run([&](size_t t) { f(t, n*t/k, n*(t+1)/k); });
+}
+// END
+
+#ifdef BUILD_TEST_THREADPOOL
+#include <iostream>
+#include <atomic>
+
+int main() {
+    cerr << "test thread_pool" << endl;
+    for (size_t threads = 0; threads <= 4; ++threads) {
+        thread_pool P(threads);
+        for (size_t n = 0; n < 10000; n += 997) {
+            vector<int> hit(n, 0);
+            for (int rep = 0; rep < 3; ++rep)
+                split_range(&P, n, [&](size_t, size_t lo, size_t hi) {
+                    for (size_t i = lo; i < hi; ++i) ++hit[i];
+                }, 1);
+            if (count(hit.begin(), hit.end(), 3) != (long)n) {
+                cerr << "split_range with " << threads << " threads missed or repeated an index" << endl;
+            }
+        }
+        atomic<size_t> calls(0);
+        for (int rep = 0; rep < 1000; ++rep) P.run([&](size_t) { ++calls; });
+        if (calls != 1000 * P.threads) {
+            cerr << "thread_pool with " << threads << " threads ran " << calls << " jobs" << endl;
+        }
+    }
+    return 0;
+}
+#endif // BUILD_TEST_THREADPOOL
+#endif // THREADPOOL_CC